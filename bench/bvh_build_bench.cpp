@@ -0,0 +1,71 @@
+// BVH构建时间随线程数的扩展性测试
+// 用法: bvh_build_bench [三角形数量=1000000] [最大线程数=omp_get_max_threads()]
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <omp.h>
+
+#include "UtilsHelper.h"
+#include "Triangle.h"
+#include "BVH.h"
+
+// 生成起伏的网格曲面，模拟大型扫描/细分网格
+static std::vector<Triangle> generateMesh(int count)
+{
+    int n = std::max(1, (int)std::sqrt(count / 2.0));
+    std::vector<Point> points;
+    for (int i = 0; i <= n; i++)
+        for (int j = 0; j <= n; j++)
+        {
+            float x = (float)i / n, z = (float)j / n;
+            float y = 0.1f * std::sin(20.0f * x) * std::cos(15.0f * z) + 0.01f * randomUniform();
+            points.emplace_back(QVector3D(x, y, z), QVector3D(0.0f, 1.0f, 0.0f), QVector2D(x, z));
+        }
+    std::vector<Triangle> triangles;
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < n; j++)
+        {
+            int p = i * (n + 1) + j;
+            triangles.emplace_back(points[p], points[p + 1], points[p + n + 1]);
+            triangles.emplace_back(points[p + 1], points[p + n + 2], points[p + n + 1]);
+        }
+    return triangles;
+}
+
+int main(int argc, char **argv)
+{
+    int count = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    int maxThreads = argc > 2 ? std::atoi(argv[2]) : omp_get_max_threads();
+    std::vector<Triangle> triangles = generateMesh(count);
+    std::printf("triangles: %zu, max threads: %d\n", triangles.size(), maxThreads);
+
+    // 线程数按1, 2, 4, ...递增，最后一项为最大线程数
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+
+    const char *names[] = {"median", "sah", "lbvh", "sbvh"};
+    for (BVHBuildMethod method : {BVH_BUILD_MEDIAN, BVH_BUILD_SAH, BVH_BUILD_LBVH, BVH_BUILD_SBVH})
+    {
+        std::printf("%-8s %8s %12s %8s\n", "method", "threads", "build(s)", "speedup");
+        double serial = 0.0;
+        for (int threads : threadCounts)
+        {
+            omp_set_num_threads(threads);
+            // 取三次构建中的最短时间
+            double best = 1e30;
+            for (int k = 0; k < 3; k++)
+            {
+                double start = cpuSecond();
+                BVH bvh(triangles, method);
+                best = std::min(best, cpuSecond() - start);
+            }
+            if (threads == 1)
+                serial = best;
+            std::printf("%-8s %8d %12.4f %7.2fx\n", names[method], threads, best, serial / best);
+        }
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,76 @@
+// 按面积选择三角形的三种方法的对比：线性扫描、CDF二分查找与别名表（场景的光源表使用别名表）
+// 用法: light_sample_bench [采样次数=10000000]
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "UtilsHelper.h"
+#include "AliasTable.h"
+
+// 原Mesh::sample中的线性扫描
+static int sampleLinear(const std::vector<float> &areas, float total, float u)
+{
+    float t = u * total;
+    for (int i = 0; i < (int)areas.size(); i++)
+    {
+        t -= areas[i];
+        if (t <= 0.0f)
+            return i;
+    }
+    return (int)areas.size() - 1;
+}
+
+// 在累积分布上二分查找
+static int sampleCDF(const std::vector<float> &cdf, float u)
+{
+    int i = (int)(std::upper_bound(cdf.begin(), cdf.end(), u * cdf.back()) - cdf.begin());
+    return std::min(i, (int)cdf.size() - 1);
+}
+
+int main(int argc, char **argv)
+{
+    int samples = argc > 1 ? std::atoi(argv[1]) : 10000000;
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    std::vector<float> randoms(1 << 16);
+    for (float &u : randoms)
+        u = uniform(generator);
+
+    std::printf("%10s %14s %14s %14s\n", "triangles", "linear(ns)", "cdf(ns)", "alias(ns)");
+    for (int count = 16; count <= 1 << 18; count *= 4)
+    {
+        // 面积相差较大的细分光源
+        std::vector<float> areas(count), cdf(count);
+        float total = 0.0f;
+        for (int i = 0; i < count; i++)
+        {
+            areas[i] = 0.1f + uniform(generator) * uniform(generator);
+            total += areas[i];
+            cdf[i] = total;
+        }
+        AliasTable table(areas);
+
+        // 线性扫描在大网格上太慢，按比例减少采样次数
+        int linearSamples = std::max(1000, (int)std::min<long long>(samples, 200000000LL / count));
+        long long checksum = 0;
+        double start = cpuSecond();
+        for (int i = 0; i < linearSamples; i++)
+            checksum += sampleLinear(areas, total, randoms[i & 0xffff]);
+        double linear = (cpuSecond() - start) / linearSamples * 1e9;
+
+        start = cpuSecond();
+        for (int i = 0; i < samples; i++)
+            checksum += sampleCDF(cdf, randoms[i & 0xffff]);
+        double binary = (cpuSecond() - start) / samples * 1e9;
+
+        start = cpuSecond();
+        for (int i = 0; i < samples; i++)
+            checksum += table.sample(randoms[i & 0xffff], randoms[(i + 1) & 0xffff]);
+        double alias = (cpuSecond() - start) / samples * 1e9;
+
+        std::printf("%10d %14.2f %14.2f %14.2f   (checksum %lld)\n", count, linear, binary, alias, checksum);
+    }
+    return 0;
+}
@@ -0,0 +1,78 @@
+// 光线流求交吞吐量随批大小的变化
+// 用法: ray_stream_bench <obj路径> [光线数量=1000000]
+// 从相机发出主光线，在交点处向随机方向发出次级光线，再将次级光线按不同批大小交给Scene::traceStream
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <omp.h>
+
+#include <tinyxml2/tinyxml2.h>
+
+#include "UtilsHelper.h"
+#include "Scene.h"
+#include "camera.h"
+
+// 单位球面上的均匀随机方向
+static QVector3D randomDirection()
+{
+    float z = 2.0f * randomUniform() - 1.0f, phi = 2.0f * PI * randomUniform();
+    float r = std::sqrt(std::max(0.0f, 1.0f - z * z));
+    return QVector3D(r * std::cos(phi), r * std::sin(phi), z);
+}
+
+// 以给定批大小追踪全部光线，取三次中的最短时间，返回每秒百万条光线数
+static double measure(const Scene &scene, const std::vector<Ray> &rays, size_t batch)
+{
+    std::vector<Ray> part;
+    std::vector<HitRecord> result;
+    double best = 1e30;
+    for (int k = 0; k < 3; k++)
+    {
+        double start = cpuSecond();
+        for (size_t begin = 0; begin < rays.size(); begin += batch)
+        {
+            part.assign(rays.begin() + begin, rays.begin() + std::min(rays.size(), begin + batch));
+            scene.traceStream(part, result);
+        }
+        best = std::min(best, cpuSecond() - start);
+    }
+    return rays.size() / best / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        std::printf("usage: %s <obj> [rays]\n", argv[0]);
+        return 1;
+    }
+    std::string meshPath = argv[1];
+    size_t count = argc > 2 ? std::atoi(argv[2]) : 1000000;
+    Scene scene(meshPath, true);
+    tinyxml2::XMLDocument doc;
+    doc.LoadFile((meshPath.substr(0, meshPath.find_last_of('.')) + ".xml").c_str());
+    Camera cam(doc);
+
+    // 主光线按像素顺序排列，本身就是相干的
+    std::vector<Ray> primary;
+    while (primary.size() < count)
+        for (int j = 0; j < cam.getHeight() && primary.size() < count; j++)
+            for (int i = 0; i < cam.getWidth() && primary.size() < count; i++)
+                primary.push_back(cam.cast_ray(i, j));
+    std::vector<HitRecord> primaryHits;
+    scene.traceStream(primary, primaryHits);
+
+    // 次级光线从主光线的交点出发，方向随机，模拟一次漫反射弹射
+    std::vector<Ray> secondary;
+    for (size_t i = 0; i < primary.size(); i++)
+        if (primaryHits[i].mesh >= 0)
+            secondary.emplace_back(primary[i].point(primaryHits[i].t), randomDirection());
+    std::printf("threads: %d, primary rays: %zu, secondary rays: %zu\n", omp_get_max_threads(), primary.size(), secondary.size());
+
+    std::printf("%10s %16s %18s\n", "batch", "primary(Mrays/s)", "secondary(Mrays/s)");
+    for (size_t batch = 64; batch <= count; batch *= 4)
+        std::printf("%10zu %16.2f %18.2f\n", batch, measure(scene, primary, batch), measure(scene, secondary, batch));
+    return 0;
+}
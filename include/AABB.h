@@ -21,17 +21,27 @@ private:
 
 public:
     AABB();
-    ~AABB();
     // 增加点
     void add(const QVector3D &point);
     // 两个AABB融合
     void combine(const AABB &aabb);
+    // 与另一个AABB求交集，不相交时变为空包围盒
+    void intersect(const AABB &aabb);
+    // 是否为空包围盒
+    bool isEmpty() const;
     //返回X、Y、Z轴的范围
     float rangeX() const;
     float rangeY() const;
     float rangeZ() const;
-    // 与光线进行相交判断
-    bool trace(const Ray &ray) const;
+    //返回最小点和最大点
+    QVector3D getMin() const;
+    QVector3D getMax() const;
+    // 中心点
+    QVector3D getCenter() const;
+    // 表面积，用于SAH代价估计
+    float surfaceArea() const;
+    // 在光线的[tmin, tmax]区间内进行相交判断，返回进入AABB时的t值，不相交时返回FLT_MAX
+    float trace(const Ray &ray) const;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,38 @@
+#ifndef ALIAS_TABLE_H
+#define ALIAS_TABLE_H
+
+#include <vector>
+
+/**
+ * @brief 别名表（Walker/Vose方法），按给定的非负权重进行O(1)的离散采样
+ */
+class AliasTable
+{
+private:
+    struct Entry
+    {
+        // 落入该槽位时选中自身的概率，否则选中alias
+        float probability;
+        int alias;
+    };
+    std::vector<Entry> entries;
+    // 每一项被选中的概率，即归一化后的权重
+    std::vector<float> pdfs;
+    // 权重之和
+    float total;
+
+public:
+    AliasTable();
+    // 由权重构建别名表，权重之和为0时表为空
+    AliasTable(const std::vector<float> &weights);
+    ~AliasTable();
+    bool empty() const;
+    int size() const;
+    float getTotal() const;
+    // 第i项被选中的概率
+    float pdf(int i) const;
+    // 用两个[0,1)内的均匀随机数选择一项：u决定槽位，v决定取槽位本身还是其alias
+    int sample(float u, float v) const;
+};
+
+#endif
@@ -9,7 +9,21 @@
 #include "Point.h"
 #include "Triangle.h"
 #include "AABB.h"
+#include "BVHBuilder.h"
+#include "WideBVH.h"
+#include "BVHTraversal.h"
 #include "Ray.h"
+#include "HitRecord.h"
+#include "RayPacket.h"
+
+/**
+ * @brief 只用于求交的三角形数据：顶点p0与两条边，共36字节
+ */
+struct TriangleRecord
+{
+    QVector3D v0, e1, e2;
+};
+
 /**
  * @brief 层次包围体结构，用于加速光线与场景截交计算
  *
@@ -18,23 +32,56 @@
 class BVH
 {
 private:
-    // 当前节点的aabb
-    AABB aabb;
-    // 当前节点的三角形序列
-    std::vector<Triangle> triangles;
-    // 左右子节点分支
-    BVH *left, *right;
-    static bool compareByX(const Triangle &t0, const Triangle &t1);
-    static bool compareByY(const Triangle &t0, const Triangle &t1);
-    static bool compareByZ(const Triangle &t0, const Triangle &t1);
+    // 深度优先顺序的节点数组，从缓存加载时直接引用映射内存
+    CacheArray<BVHNode> nodes;
+    // 按叶节点顺序重排的三角形索引
+    CacheArray<int> indices;
+    // 按叶节点中的引用顺序存放的求交数据，与indices一一对应，遍历时只访问这里
+    CacheArray<TriangleRecord> records;
+    // 由二叉BVH塌缩得到的多叉BVH，只构建BVH_WIDTH对应的一个
+    WideBVH<4> bvh4;
+    WideBVH<8> bvh8;
+    // 根据indices生成records
+    void buildRecords(const std::vector<Triangle> &triangles);
+    // 节点、索引与多叉BVH的下标是否都不越界，用于检查缓存
+    bool isValid(size_t triangleCount) const;
+    // 与叶节点中的三角形求交，找到更近的交点时记录其位置slot与重心坐标u、v，并缩小光线的tmax
+    void traceTriangles(int offset, int count, Ray &ray, float &t, int &slot, float &u, float &v) const;
+    // 二叉BVH与多叉BVH的遍历，只接受比t更近的交点；二叉BVH可以从任意子树开始遍历
+    void traceBinary(const Ray &ray, float &t, int &slot, float &u, float &v, int root = 0) const;
+    template <int N>
+    void traceWide(const WideBVH<N> &wide, const Ray &ray, float &t, int &slot, float &u, float &v) const;
+    // 光线包与叶节点中的三角形求交，返回找到更近交点的光线掩码
+    uint64_t tracePacketTriangles(int offset, int count, const RayPacket &packet, uint64_t mask, HitPacket &hit) const;
+    // 任意交点查询的叶节点求交与遍历，找到第一个交点即返回
+    bool occludedTriangles(int offset, int count, const Ray &ray) const;
+    bool occludedBinary(const Ray &ray) const;
+    template <int N>
+    bool occludedWide(const WideBVH<N> &wide, const Ray &ray) const;
 
 public:
-    // 从三角形列表中递归地构建出BVH
-    BVH(const std::vector<Triangle> &triangles);
-    BVH(const BVH &bvh);
+    // 从三角形列表中构建出BVH
+    BVH(const std::vector<Triangle> &triangles, BVHBuildMethod method = BVH_BUILD_METHOD);
+    // 直接引用场景缓存中已构建好的节点、索引与求交数据，不再重新构建；内容不合法时令reader失败
+    BVH(size_t triangleCount, CacheReader &reader);
     ~BVH();
-    // 射线与BVH截交计算，返回对应的t值和相交点
-    void trace(const Ray &ray, float &t, Point &point) const;
+    // 根节点的aabb，即整个网格的包围盒
+    AABB getAABB() const;
+    // 将节点、三角形索引与求交数据写入场景缓存，三角形本身由网格负责写入
+    void save(CacheWriter &writer) const;
+    // 射线与BVH截交计算，在光线区间内找到交点时更新hit的t、三角形下标与重心坐标并返回true
+    bool trace(const Ray &ray, HitRecord &hit) const;
+    /**
+     * @brief 相干光线包与二叉BVH截交计算，活跃光线过少时退回单光线遍历
+     *
+     * @param packet 输入光线包，需要是相干的
+     * @param mask 参与求交的光线掩码
+     * @param hit 输入输出每条光线的交点记录（不含网格下标）
+     * @return uint64_t 找到更近交点的光线掩码
+     */
+    uint64_t tracePacket(const RayPacket &packet, uint64_t mask, HitPacket &hit) const;
+    // 光线在(tmin, tmax)内是否与任意三角形相交，用于阴影光线
+    bool occluded(const Ray &ray) const;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,94 @@
+#ifndef BVH_BUILDER_H
+#define BVH_BUILDER_H
+
+#include <cfloat>
+#include <cstdint>
+#include <algorithm>
+#include <vector>
+
+#include <QVector3D>
+
+#include "ConfigHelper.h"
+#include "AABB.h"
+
+/**
+ * @brief 线性化的BVH节点，所有节点按深度优先顺序存放在同一个数组中
+ *
+ * 内部节点的左子节点紧随其后，offset为右子节点的下标；
+ * 叶节点的offset和count为其在图元索引数组中的起始位置和数量
+ */
+struct BVHNode
+{
+    // 节点的aabb
+    AABB aabb;
+    // 叶节点：图元索引起始位置；内部节点：右子节点下标
+    int32_t offset;
+    // 叶节点的图元数量，内部节点为0
+    uint16_t count;
+    // 内部节点的划分轴
+    uint8_t axis;
+    uint8_t pad;
+};
+
+static_assert(sizeof(BVHNode) == 32, "BVHNode should be 32 bytes");
+
+struct SAHBins;
+struct LBVHTree;
+struct SBVHReference;
+
+/**
+ * @brief BVH构建器，只依赖每个图元的aabb和重心，
+ * 既用于网格内部的三角形BVH，也用于场景中网格之上的顶层BVH
+ */
+class BVHBuilder
+{
+private:
+    // 每个图元的aabb与重心
+    const std::vector<AABB> &bounds;
+    const std::vector<QVector3D> &centers;
+    BVHBuildMethod method;
+    // 构建时原地划分的图元索引，并行构建的子树各自占据互不重叠的区间
+    std::vector<int> *indices;
+    // SBVH裁剪三角形用的顶点，每个图元3个，为空时SBVH退化为SAH
+    const std::vector<QVector3D> *vertices;
+    // SBVH当前的图元引用数量与上限，以及根节点面积
+    int sbvhReferences, sbvhLimit;
+    float rootArea;
+    // 递归地将[begin, end)范围内的子树构建到nodes中，返回子树根节点下标
+    int build(std::vector<BVHNode> &nodes, int begin, int end);
+    // 将独立构建的子树拼接到nodes末尾，叶节点的图元区间加上indexOffset，返回子树根节点下标
+    static int append(std::vector<BVHNode> &nodes, const std::vector<BVHNode> &subtree, int indexOffset = 0);
+    // 计算[begin, end)范围内图元的aabb与重心的aabb
+    void computeBounds(int begin, int end, AABB &aabb, AABB &centerBox) const;
+    // 按最长轴物体数量中点进行划分，返回划分位置
+    int splitMedian(const AABB &aabb, int begin, int end, int &axis);
+    // 分箱SAH划分，返回划分位置，返回-1表示作为叶节点代价更低
+    int splitSAH(const AABB &aabb, const AABB &centerBox, int begin, int end, int &axis);
+    // 将[begin, end)范围内的图元按重心放入三个轴的桶中
+    void binPrimitives(int begin, int end, const QVector3D &low, const QVector3D &scale, SAHBins &bins) const;
+    // LBVH：计算重心的Morton码并基数排序，再按Morton码的最高不同位自顶向下划分
+    void buildLBVH(std::vector<BVHNode> &nodes);
+    // 递归地为Morton码有序的[begin, end)范围构建LBVH子树，返回节点编号
+    int emitLBVH(LBVHTree &tree, const std::vector<uint64_t> &codes, int begin, int end) const;
+    // SBVH：递归地为一组图元引用构建子树，叶节点的引用依次写入leafIndices，返回子树根节点下标
+    int buildSBVH(std::vector<BVHNode> &nodes, std::vector<int> &leafIndices, std::vector<SBVHReference> &references);
+    // 在引用的重心上进行分箱SAH物体划分，返回代价N_l*SA_l+N_r*SA_r，没有有效划分时返回FLT_MAX
+    float splitObject(const std::vector<SBVHReference> &references, const AABB &centerBox, int &axis, int &split, AABB &leftBox, AABB &rightBox) const;
+    // 在节点aabb内等宽分桶，裁剪跨越桶边界的三角形，返回最优空间划分的代价与划分平面
+    float splitSpatial(const std::vector<SBVHReference> &references, const AABB &aabb, int &axis, float &position) const;
+    // 按空间划分平面分配引用，跨越平面的引用按代价选择放入一侧或裁剪后两侧都放，返回新增的引用数量
+    int partitionSpatial(const std::vector<SBVHReference> &references, int axis, float position, std::vector<SBVHReference> &left, std::vector<SBVHReference> &right) const;
+    // 用平面axis=position裁剪三角形index位于aabb内的部分，得到两侧的包围盒
+    void splitReference(int index, const AABB &aabb, int axis, float position, AABB &left, AABB &right) const;
+
+public:
+    BVHBuilder(const std::vector<AABB> &bounds, const std::vector<QVector3D> &centers, BVHBuildMethod method = BVH_BUILD_METHOD);
+    ~BVHBuilder();
+    // 提供三角形顶点（每个图元连续3个），SBVH需要用它们裁剪跨越划分平面的三角形
+    void setTriangles(const std::vector<QVector3D> &vertices);
+    // 构建BVH，输出深度优先顺序的节点数组和按叶节点顺序重排的图元索引
+    // 图元较多时使用OpenMP任务并行构建
+    void build(std::vector<BVHNode> &nodes, std::vector<int> &indices);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,231 @@
+#ifndef BVH_TRAVERSAL_H
+#define BVH_TRAVERSAL_H
+
+#include <cfloat>
+#include <algorithm>
+#include <vector>
+
+#include "BVHBuilder.h"
+#include "Ray.h"
+#include "RayPacket.h"
+
+/**
+ * @brief BVH遍历用的显式栈：前N个元素放在定长数组中，更深时溢出到堆上的vector
+ *
+ * 构建器不限制树的深度，SBVH的空间划分或退化的几何可能产生很深的树，
+ * 栈不能有固定的上限；常见深度下只访问定长数组，与普通数组栈一样快
+ */
+template <typename T, int N = 64>
+class TraversalStack
+{
+private:
+    T local[N];
+    // 第N个及之后的元素，大小总是max(0, count - N)
+    std::vector<T> overflow;
+    int count;
+
+public:
+    TraversalStack() : count(0) {}
+
+    bool empty() const
+    {
+        return count == 0;
+    }
+
+    int size() const
+    {
+        return count;
+    }
+
+    void push(const T &value)
+    {
+        if (count < N)
+            local[count] = value;
+        else
+            overflow.push_back(value);
+        count++;
+    }
+
+    T &top()
+    {
+        return (*this)[count - 1];
+    }
+
+    void pop()
+    {
+        if (count > N)
+            overflow.pop_back();
+        count--;
+    }
+
+    // 按从栈底开始的下标访问，用于在栈顶附近插入排序
+    T &operator[](int index)
+    {
+        return index < N ? local[index] : overflow[index - N];
+    }
+};
+
+/**
+ * @brief 检查深度优先节点数组的结构，遍历时不检查下标，从缓存读取的节点必须先经过这里
+ *
+ * 内部节点的两个子节点都在其之后（保证遍历会结束），叶节点的图元区间在[0, primitives)内；
+ * 只有一个包围盒为空、没有图元的根节点时为空树
+ */
+inline bool isValidTree(const BVHNode *nodes, size_t count, size_t primitives)
+{
+    if (count == 0)
+        return false;
+    if (count == 1 && nodes[0].count == 0)
+        return nodes[0].aabb.isEmpty();
+    for (size_t i = 0; i < count; i++)
+    {
+        const BVHNode &node = nodes[i];
+        if (node.count > 0)
+        {
+            if (node.offset < 0 || (size_t)node.offset + node.count > primitives)
+                return false;
+        }
+        else if (i + 1 >= count || node.offset <= (int64_t)(i + 1) || (size_t)node.offset >= count)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 二叉BVH的最近交点遍历，网格内的三角形BVH与场景的顶层BVH共用
+ *
+ * 先访问进入距离更近的子节点，较远的子节点连同进入距离入栈，弹出时剔除进入距离超过ray当前tmax的节点
+ *
+ * @param nodes 深度优先顺序的节点数组
+ * @param root 开始遍历的子树根节点
+ * @param ray 输入光线，leaf找到更近的交点时应缩小其tmax
+ * @param leaf 叶节点回调leaf(offset, count)，与叶节点中的图元求交
+ */
+template <typename Leaf>
+inline void traverseClosest(const BVHNode *nodes, int root, Ray &ray, Leaf leaf)
+{
+    if (nodes[root].aabb.trace(ray) == FLT_MAX)
+        return;
+    // 待访问的较远子节点及其进入距离
+    struct Entry
+    {
+        int node;
+        float t;
+    };
+    TraversalStack<Entry> stack;
+    int current = root;
+    while (true)
+    {
+        const BVHNode &node = nodes[current];
+        if (node.count > 0)
+            leaf(node.offset, (int)node.count);
+        else
+        {
+            int near = current + 1, far = node.offset;
+            float tNear = nodes[near].aabb.trace(ray), tFar = nodes[far].aabb.trace(ray);
+            if (tFar < tNear)
+            {
+                std::swap(near, far);
+                std::swap(tNear, tFar);
+            }
+            if (tNear < FLT_MAX)
+            {
+                if (tFar < FLT_MAX)
+                    stack.push({far, tFar});
+                current = near;
+                continue;
+            }
+        }
+        // 弹出下一个节点，跳过位于当前最近交点之后的节点
+        while (!stack.empty() && stack.top().t > ray.getTMax())
+            stack.pop();
+        if (stack.empty())
+            break;
+        current = stack.top().node;
+        stack.pop();
+    }
+}
+
+/**
+ * @brief 二叉BVH的任意交点遍历，用于遮挡查询，子节点不需要按距离排序
+ *
+ * @param nodes 深度优先顺序的节点数组
+ * @param ray 输入光线
+ * @param leaf 叶节点回调leaf(offset, count)，返回true表示找到交点，遍历立即结束
+ * @return bool 是否找到交点
+ */
+template <typename Leaf>
+inline bool traverseAny(const BVHNode *nodes, const Ray &ray, Leaf leaf)
+{
+    if (nodes[0].aabb.trace(ray) == FLT_MAX)
+        return false;
+    TraversalStack<int> stack;
+    int current = 0;
+    while (true)
+    {
+        const BVHNode &node = nodes[current];
+        if (node.count > 0)
+        {
+            if (leaf(node.offset, (int)node.count))
+                return true;
+        }
+        else
+        {
+            bool hitLeft = nodes[current + 1].aabb.trace(ray) < FLT_MAX;
+            bool hitRight = nodes[node.offset].aabb.trace(ray) < FLT_MAX;
+            if (hitLeft && hitRight)
+                stack.push(node.offset);
+            if (hitLeft || hitRight)
+            {
+                current = hitLeft ? current + 1 : node.offset;
+                continue;
+            }
+        }
+        if (stack.empty())
+            return false;
+        current = stack.top();
+        stack.pop();
+    }
+}
+
+/**
+ * @brief 二叉BVH的光线包遍历，网格内的三角形BVH与场景的顶层BVH共用
+ *
+ * 每个节点先求出与其包围盒相交的活跃光线，子节点按光线包的平均方向由近到远访问
+ *
+ * @param nodes 深度优先顺序的节点数组
+ * @param packet 输入光线包，需要是相干的
+ * @param mask 参与遍历的光线掩码
+ * @param t 每条光线当前最近交点的t值，visit找到更近的交点时应同时更新
+ * @param visit 节点回调visit(node, active)，active为与节点相交的光线掩码；返回true表示节点已处理完（叶节点必须如此），
+ * 不再展开其子节点，可以借此在活跃光线过少时改为对子树做单光线遍历
+ */
+template <typename Visit>
+inline void traversePacket(const BVHNode *nodes, const RayPacket &packet, uint64_t mask, const float *t, Visit visit)
+{
+    struct Entry
+    {
+        int node;
+        uint64_t mask;
+    };
+    TraversalStack<Entry> stack;
+    stack.push({0, mask});
+    while (!stack.empty())
+    {
+        Entry entry = stack.top();
+        stack.pop();
+        uint64_t active = packet.intersect(nodes[entry.node].aabb, entry.mask, t);
+        if (active == 0 || visit(entry.node, active))
+            continue;
+        const BVHNode &node = nodes[entry.node];
+        if (node.count > 0)
+            continue;
+        int near = entry.node + 1, far = node.offset;
+        if (packet.order(nodes[far].aabb) < packet.order(nodes[near].aabb))
+            std::swap(near, far);
+        stack.push({far, active});
+        stack.push({near, active});
+    }
+}
+
+#endif
@@ -2,26 +2,146 @@
 #define CONFIG_HELPER_H
 
 #include <cmath>
+#include <cstdint>
 
 //pi
 const float PI = std::acos(-1);
 
 //0值判断精度
 const float EPSILON = 1e-7f;
+//阴影光线的tmax比到光源采样点的距离短这一比例，避免与光源自身相交
+const float SHADOW_EPSILON = 1e-4f;
 //伽马校正
 const float GAMMA = 2.2f;
 
-//分层采样控制层数
-const int STRATIFY_SIZE = 10;
+//BVH构建方法：按最长轴物体中位数划分，分箱SAH（表面积启发式）划分，
+//或按Morton码排序的LBVH（构建最快，适合预览和频繁修改的场景），
+//或允许裁剪三角形进行空间划分的SBVH（构建较慢，适合含有大量细长三角形的建筑场景）
+enum BVHBuildMethod
+{
+    BVH_BUILD_MEDIAN,
+    BVH_BUILD_SAH,
+    BVH_BUILD_LBVH,
+    BVH_BUILD_SBVH
+};
+const BVHBuildMethod BVH_BUILD_METHOD = BVH_BUILD_SAH;
 
-//BV节点容纳的三角形最小极限数量
+//中位数划分时BV节点容纳的三角形最小极限数量
 const int BVH_LIMIT = 1;
 
-//俄罗斯轮盘赌的上限和概率
+//SAH每个轴上的分箱数量
+const int BVH_SAH_BINS = 16;
+//SAH代价模型中遍历一个内部节点与求交一个三角形的相对代价
+const float BVH_TRAVERSAL_COST = 1.0f;
+const float BVH_INTERSECTION_COST = 1.0f;
+//SAH叶节点容纳的三角形最大数量，超过时即使划分代价更高也强制划分
+const int BVH_MAX_LEAF_SIZE = 8;
+
+//LBVH的Morton码位数（30或63）和叶节点容纳的最大图元数量
+const int BVH_LBVH_MORTON_BITS = 30;
+const int BVH_LBVH_LEAF_SIZE = 4;
+//LBVH构建后用SAH对treelet（最多7个叶子的局部子树）重新组织的遍数，0为不优化，
+//只处理图元数量不少于BVH_LBVH_TREELET_MIN_SIZE的子树
+const int BVH_LBVH_TREELET_PASSES = 1;
+const int BVH_LBVH_TREELET_MIN_SIZE = 64;
+
+//SBVH：物体划分两侧的重叠面积超过根节点面积的BVH_SBVH_ALPHA倍时才尝试空间划分
+//BVH_SBVH_BUDGET为图元引用数量相对三角形数量允许增长的比例，用完后只进行物体划分
+const int BVH_SBVH_BINS = 32;
+const float BVH_SBVH_ALPHA = 1e-5f;
+const float BVH_SBVH_BUDGET = 0.3f;
+
+//并行构建BVH：图元数量不少于该值的子树作为独立的OpenMP任务构建，
+//并且按该块大小分块并行计算包围盒与SAH分箱
+const int BVH_PARALLEL_THRESHOLD = 4096;
+const int BVH_PARALLEL_CHUNK = 16384;
+
+//网格BVH的分支数：2为二叉BVH，4为BVH4（SSE），8为BVH8（AVX），4和8由二叉BVH塌缩得到
+const int BVH_WIDTH = 4;
+
+//主光线包：按PACKET_TILE_SIZE x PACKET_TILE_SIZE的像素块（4或8）生成主光线并作为光线包求交，为1时逐条光线求交
+const int PACKET_TILE_SIZE = 4;
+//光线包中活跃光线少于该值时认为已经发散，剩余光线退回单光线遍历
+const int PACKET_MIN_ACTIVE_RAYS = 2;
+
+//光线流：不少于STREAM_SORT_THRESHOLD条的光线批先按方向卦限与起点所在网格单元排序再求交，
+//单元网格每个轴划分为2^STREAM_CELL_BITS份（不超过4，使排序键不超过16位）；排序后同一卦限的连续光线按STREAM_PACKET_SIZE条一组，
+//组内方向与平均方向夹角的余弦都不小于STREAM_PACKET_MIN_SPREAD时作为光线包求交，否则逐条求交
+const int STREAM_SORT_THRESHOLD = 1024;
+const int STREAM_CELL_BITS = 4;
+const int STREAM_PACKET_SIZE = 16;
+const float STREAM_PACKET_MIN_SPREAD = 0.995f;
+
+//场景缓存：在obj旁写入二进制缓存，下次加载时直接映射到内存，修改缓存格式时需要增加版本号
+const bool SCENE_CACHE_ENABLED = true;
+const int SCENE_CACHE_VERSION = 4;
+
+//俄罗斯轮盘赌：弹射次数达到RUSSIAN_ROULETTE_THRESHOLD后，以路径通量的最大分量作为继续的概率，
+//该概率不超过RUSSIAN_ROULETTE_MAX_PROBABILITY，保证通量不衰减的路径（如玻璃内部的全反射）也会终止
 const int RUSSIAN_ROULETTE_THRESHOLD = 3;
-const float RUSSIAN_ROULETTE_PROBABILITY = 0.9f;
+const float RUSSIAN_ROULETTE_MAX_PROBABILITY = 0.95f;
+
+//每个着色点的光源采样次数，每次按功率选择一个发光三角形
+const int LIGHT_SAMPLES = 1;
+
+//光源采样与brdf采样的多重重要性采样（MIS）权重：MIS_NONE时直接光照只来自光源采样，
+//brdf采样击中光源的路径被丢弃；否则两种策略都保留，分别按平衡启发式或幂启发式（指数为2）加权
+enum MISHeuristic
+{
+    MIS_NONE,
+    MIS_BALANCE,
+    MIS_POWER
+};
+const MISHeuristic MIS_HEURISTIC = MIS_POWER;
+
+//路径的最大弹射次数
+const int PATH_MAX_DEPTH = 64;
 
 //ssp
 static int SAMPLE_PER_PIXEL = 64;
 
+//渲染块的边长，块按Morton顺序调度，线程之间可以窃取
+const int RENDER_TILE_SIZE = 32;
+//界面渐进显示时每个渲染任务的采样次数，每完成一轮刷新一次图像
+const int RENDER_TILE_SAMPLES = 4;
+//为true时每个线程累积到私有的缓冲区，渲染结束后合并；渲染块互不重叠且按缓存行对齐，默认直接写入共享缓冲区
+const bool FRAMEBUFFER_PER_THREAD = false;
+
+//随机数种子，与像素序号和样本序号一起决定每个样本的随机数序列，相同种子的渲染结果可逐位复现
+const uint64_t RANDOM_SEED = 0x2545f4914f6cdd1dULL;
+//每个样本的随机数维度划分：相机（像素内位置）从第0维开始，路径从第RANDOM_PATH_DIMENSION维开始，
+//每次弹射占用RANDOM_BOUNCE_DIMENSIONS维：每次光源采样RANDOM_LIGHT_DIMENSIONS维（三角形内位置2维、
+//别名表的槽位与是否取alias各1维、brdf波瓣1维），之后是出射方向2维、选择波瓣（或菲涅尔反射）1维与俄罗斯轮盘1维
+const uint32_t RANDOM_PATH_DIMENSION = 16;
+const uint32_t RANDOM_LIGHT_DIMENSIONS = 5;
+const uint32_t RANDOM_BOUNCE_DIMENSIONS = RANDOM_LIGHT_DIMENSIONS * LIGHT_SAMPLES + 4;
+
+//采样器：独立随机数，Owen置乱的Sobol序列，Halton序列，或蓝噪声抖动的Sobol序列
+enum SamplerType
+{
+    SAMPLER_RANDOM,
+    SAMPLER_SOBOL,
+    SAMPLER_HALTON,
+    SAMPLER_BLUE_NOISE
+};
+const SamplerType SAMPLER_TYPE = SAMPLER_SOBOL;
+//蓝噪声掩码的边长
+const int BLUE_NOISE_SIZE = 64;
+
+//自适应采样：每个像素至少采样ADAPTIVE_MIN_SAMPLES次，此后均值的相对误差（标准误差/(亮度+ADAPTIVE_ERROR_EPSILON)）
+//低于ADAPTIVE_ERROR_THRESHOLD的像素不再采样；未收敛的像素每轮的样本数与相对误差超出阈值的倍数成正比，
+//每轮至多ADAPTIVE_PASS_SAMPLES个，样本数上限由调用方给出
+const int ADAPTIVE_MIN_SAMPLES = 16;
+const float ADAPTIVE_ERROR_THRESHOLD = 0.05f;
+const float ADAPTIVE_ERROR_EPSILON = 0.01f;
+const int ADAPTIVE_PASS_SAMPLES = 8;
+
+//降噪：à-trous滤波的迭代次数（最大采样间隔为2^(DENOISER_ITERATIONS-1)），照度、法线、深度边缘停止函数的容差，
+//照度按l/(1+l)压缩后比较，深度按相对差异比较；反照率低于DENOISER_ALBEDO_EPSILON的通道不解调
+const int DENOISER_ITERATIONS = 4;
+const float DENOISER_SIGMA_COLOR = 0.2f;
+const float DENOISER_SIGMA_NORMAL = 0.1f;
+const float DENOISER_SIGMA_DEPTH = 0.02f;
+const float DENOISER_ALBEDO_EPSILON = 0.001f;
+
 #endif
\ No newline at end of file
@@ -0,0 +1,62 @@
+#ifndef DENOISER_H
+#define DENOISER_H
+
+#include <vector>
+
+#include <QVector3D>
+
+#include "ConfigHelper.h"
+#include "Framebuffer.h"
+
+/**
+ * @brief 降噪用的辅助缓冲区（AOV），与结果图像一起按样本累积：
+ * 第一个交点的表面反照率、着色法线与到相机的距离，没有交点时均为0
+ */
+struct AOVBuffers
+{
+    Framebuffer albedo, normal, depth;
+
+    AOVBuffers(int width, int height);
+};
+
+// 一个样本在第一个交点处的AOV取值
+struct FirstHit
+{
+    QVector3D albedo, normal;
+    float depth;
+};
+
+/**
+ * @brief 边缘保持的à-trous小波滤波器（Dammertz 2010）
+ *
+ * 先用反照率解调得到照度，在照度上迭代DENOISER_ITERATIONS次5x5的B3样条滤波，第i次的采样间隔为2^i，
+ * 每个邻域像素的权重再乘以照度、法线与深度三项的边缘停止函数，最后乘回反照率，
+ * 因此纹理细节与几何边缘不会被模糊。按行多线程，行内对连续的像素使用SIMD
+ */
+class Denoiser
+{
+private:
+    int width, height;
+    // 按平面存储（SoA）的输入：照度、反照率、法线、深度，以及照度的亮度压缩值，用于边缘停止函数
+    std::vector<float> color[3], albedo[3], normal[3], depth, key;
+    // 迭代的输出
+    std::vector<float> filtered[3];
+
+    // 第iteration次迭代，从color滤波到filtered
+    void iterate(int iteration);
+
+public:
+    Denoiser(int width, int height);
+    ~Denoiser();
+
+    /**
+     * @brief 对结果图像降噪
+     *
+     * @param beauty 输入的结果图像
+     * @param aovs 输入的辅助缓冲区，与结果图像样本数相同
+     * @param output 输出的降噪图像，每个像素的权重为1
+     */
+    void denoise(const Framebuffer &beauty, const AOVBuffers &aovs, Framebuffer &output);
+};
+
+#endif
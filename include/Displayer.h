@@ -2,6 +2,7 @@
 #define RENDER_WIDGET_H
 
 #include <vector>
+#include <memory>
 
 #include <QVector3D>
 #include <QWidget>
@@ -14,6 +15,7 @@
 #include <QIntValidator>
 #include <QButtonGroup>
 #include <QPushButton>
+#include <QCheckBox>
 #include <QString>
 #include <QImage>
 #include <QCoreApplication>
@@ -39,12 +41,20 @@ private:
     QRadioButton sceneButton0, sceneButton1, sceneButton2, threshmethodButton0, threshmethodButton1;
     //编辑框
     QLineEdit sppEdit, iprEdit;
+    //自适应采样开关，降噪开关
+    QCheckBox adaptiveBox, denoiseBox;
     //监听器
     QIntValidator validator;
     QPushButton calculateButton, saveButton;
     Scene scene;
     QImage image;
-    void refresh(const std::vector<std::vector<QVector3D>> &sum, const int sample);
+    //自适应采样时每个像素的样本数，越亮样本越多
+    QImage sampleMap;
+    //开启降噪时的辅助缓冲区与降噪器，显示与保存的都是降噪后的图像
+    std::unique_ptr<AOVBuffers> aovs;
+    std::unique_ptr<Denoiser> denoiser;
+    //将累积缓冲区的估计值显示出来
+    void refresh(const Framebuffer &frame);
 
 
 public:
@@ -0,0 +1,18 @@
+#ifndef EMITTER_H
+#define EMITTER_H
+
+#include <QVector3D>
+
+/**
+ * @brief 发光三角形，场景加载后由所有自发光网格的三角形生成，只用于光源采样
+ */
+struct Emitter
+{
+    // 顶点p0与两条边，用于在三角形上均匀采样
+    QVector3D v0, e1, e2;
+    // 几何法线（朝向与顶点法线一致）与辐射度
+    QVector3D normal, radiance;
+    float area;
+};
+
+#endif
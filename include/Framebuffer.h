@@ -0,0 +1,61 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <vector>
+
+#include <QVector3D>
+#include <QImage>
+
+/**
+ * @brief 累积缓冲区：一块连续的、按行存储的RGBA浮点缓冲，RGB为辐射度之和，A为样本权重之和
+ *
+ * 起始地址按缓存行对齐，每行的像素数补齐到缓存行的整数倍，
+ * 因此x方向按RENDER_TILE_SIZE对齐的渲染块在不同线程中写入时不会共享缓存行
+ */
+class Framebuffer
+{
+public:
+    // 每个像素的浮点数个数
+    static const int CHANNELS = 4;
+    // 缓存行字节数
+    static const int ALIGNMENT = 64;
+
+private:
+    int width, height;
+    // 每行的像素数（含补齐部分）
+    int stride;
+    // 实际分配的存储，pixels为其中按ALIGNMENT对齐的起始位置
+    std::vector<float> storage;
+    float *pixels;
+
+public:
+    Framebuffer();
+    Framebuffer(int width, int height);
+    Framebuffer(const Framebuffer &other);
+    Framebuffer &operator=(const Framebuffer &other);
+    ~Framebuffer();
+    int getWidth() const;
+    int getHeight() const;
+    int getStride() const;
+    // 第y行第一个像素的地址
+    float *row(int y);
+    const float *row(int y) const;
+    // 向像素(x, y)累加一个样本
+    void add(int x, int y, const QVector3D &radiance, float weight = 1.0f);
+    // 像素(x, y)的样本权重之和
+    float getWeight(int x, int y) const;
+    // 像素(x, y)的估计值，即辐射度之和除以权重之和，没有样本时为0
+    QVector3D getColor(int x, int y) const;
+    // 所有像素清零
+    void clear();
+    // 逐像素累加另一个同样大小的缓冲区（如线程私有的缓冲区）
+    void merge(const Framebuffer &other);
+    // 只累加other中[x0, x1)×[y0, y1)区域，并将other中的该区域清零，使other可以在下一轮继续使用
+    void mergeRegion(Framebuffer &other, int x0, int y0, int x1, int y1);
+    // 将估计值经gamma校正后写入同样大小的RGB32图像
+    void toImage(QImage &image) const;
+    // 将样本权重按最大值归一化为灰度写入同样大小的RGB32图像，自适应采样时即样本数图
+    void weightsToImage(QImage &image) const;
+};
+
+#endif
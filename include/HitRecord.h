@@ -0,0 +1,22 @@
+#ifndef HIT_RECORD_H
+#define HIT_RECORD_H
+
+#include <cfloat>
+
+/**
+ * @brief 光线与场景的交点记录，遍历时只记录这些信息，
+ * 法线与纹理坐标的插值、材料与纹理的读取在确定最近交点之后才进行
+ */
+struct HitRecord
+{
+    // 光线参数t，未相交时为FLT_MAX
+    float t;
+    // 网格下标与网格内的三角形下标
+    int mesh, primitive;
+    // 交点在三角形中的重心坐标
+    float u, v;
+
+    HitRecord() : t(FLT_MAX), mesh(-1), primitive(-1), u(0.0f), v(0.0f) {}
+};
+
+#endif
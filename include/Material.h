@@ -7,6 +7,7 @@
 #include "Ray.h"
 #include "ConfigHelper.h"
 #include "UtilsHelper.h"
+#include "SceneCache.h"
 /**
  * @brief 材质类，存储经典的phong shading需要的参数
  */
@@ -23,14 +24,22 @@ private:
     float threshold;
     // 采样阈值方法
     bool threshold_method;
+    // 根据材料参数与阈值方法计算采样阈值
+    void computeThreshold();
 
 public:
     Material();
     Material(const QVector3D &diffuse, const QVector3D &specular, const QVector3D &emissive, const float shininess, const QVector3D transmittance, const float ior, bool threshold_method);
+    // 从场景缓存中读取材料参数，采样阈值按当前的阈值方法重新计算
+    Material(CacheReader &reader, bool threshold_method);
     ~Material();
     QVector3D getEmissive() const;
     float getIor() const;
     float getThreshold() const;
+    // 将材料参数写入场景缓存
+    void save(CacheWriter &writer) const;
+    // 降噪用的表面反照率：Phong材料为漫反射系数*纹理与镜面反射系数之和（不超过1），玻璃为透射率
+    QVector3D albedo(const QVector3D &color) const;
     // 计算漫反射BRDF，view-independent
     QVector3D diffuseBRDF() const;
     // 计算镜面反射BRDF，view-dependent，输入为完美镜面反射和采样的反射光线
@@ -56,6 +65,17 @@ public:
      * @param albedo 输出的brdf*cos/pdf     *
      */
     void sample(const QVector3D &normal, const QVector3D &reflection, const QVector3D &color, QVector3D &direction, QVector3D &albedo) const;
+
+    /**
+     * @brief sample生成出射方向direction的概率密度（立体角测度），
+     * 即按采样阈值混合的余弦加权漫反射pdf与cos^n镜面反射pdf，用于多重重要性采样
+     *
+     * @param normal 输入的法线
+     * @param reflection 输入的反射光线方向
+     * @param direction 输入的出射方向
+     * @return float 概率密度
+     */
+    float pdf(const QVector3D &normal, const QVector3D &reflection, const QVector3D &direction) const;
 };
 
 #endif
\ No newline at end of file
@@ -7,40 +7,49 @@
 #include "Point.h"
 #include "Triangle.h"
 #include "BVH.h"
-#include "Material.h"
 #include "Texture.h"
 #include "Ray.h"
+#include "HitRecord.h"
+#include "SceneCache.h"
 /**
- * @brief 网格类，一个网格类对应一个物体（及其BVH），一种材料，一种可能的纹理
+ * @brief 网格类，一个网格类对应一个物体（及其BVH），一种材料（场景材料表中的下标），一种可能的纹理
  * 
  */
 class Mesh
 {
 private:
-    //三角形序列
-    std::vector<Triangle> triangles;
-    //三角形序列中每个三角形对应的面积
-    std::vector<float> areas;
-    //总的面积
-    float area;
+    //三角形序列，从缓存加载时直接引用映射内存
+    CacheArray<Triangle> triangles;
     //网格对应的BVH
     BVH bvh;
-    //材料
-    Material material;
+    //材料在场景材料表中的下标
+    int materialId;
     //纹理
     Texture texture;
 
 public:
-    Mesh(const std::vector<Triangle> &triangles, const Material &material, const Texture &texture);
+    Mesh(const std::vector<Triangle> &triangles, int materialId, const Texture &texture);
+    //从场景缓存中读取网格，三角形与BVH直接引用缓存的映射内存
+    Mesh(CacheReader &reader);
     ~Mesh();
+    //总面积，每次调用时遍历三角形计算
     float getArea() const;
-    Material getMaterial() const;
+    const CacheArray<Triangle> &getTriangles() const;
+    //将三角形、BVH、材料下标与纹理写入场景缓存
+    void save(CacheWriter &writer) const;
+    // 网格的包围盒
+    AABB getAABB() const;
+    int getMaterialId() const;
     //根据uv纹理坐标返回对应的纹理
     QVector3D color(const QVector2D &uv) const;
-    //光线与物体网格进行截交计算
-    void trace(const Ray &ray, float &t, Point &point) const;
-    //对物体进行采样（用于光源采样）
-    Point sample(Point point) const;
+    //光线与物体网格进行截交计算，找到比hit更近的交点时更新hit（不含网格下标）并返回true
+    bool trace(const Ray &ray, HitRecord &hit) const;
+    //相干光线包与物体网格进行截交计算，返回找到更近交点的光线掩码
+    uint64_t tracePacket(const RayPacket &packet, uint64_t mask, HitPacket &hit) const;
+    //根据交点记录插值得到交点的位置、法线与纹理坐标
+    Point interpolate(const Ray &ray, const HitRecord &hit) const;
+    //光线在(tmin, tmax)内是否被网格遮挡
+    bool occluded(const Ray &ray) const;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,53 @@
+#ifndef PIXEL_STATISTICS_H
+#define PIXEL_STATISTICS_H
+
+#include <vector>
+
+#include <QVector3D>
+
+#include "ConfigHelper.h"
+
+/**
+ * @brief 单个像素的采样统计，用Welford算法在线更新样本均值与方差，用于自适应采样
+ */
+class PixelStatistics
+{
+private:
+    // 样本数
+    int count;
+    // 各通道的样本均值与离差平方和
+    QVector3D mean, m2;
+
+public:
+    PixelStatistics();
+    ~PixelStatistics();
+    // 加入一个样本
+    void add(const QVector3D &sample);
+    int getCount() const;
+    // 当前的像素值，即样本均值
+    QVector3D getMean() const;
+    // 均值的相对误差：标准误差与亮度之比，亮度加上ADAPTIVE_ERROR_EPSILON以免暗像素的误差被放大
+    float relativeError() const;
+    // 样本数达到ADAPTIVE_MIN_SAMPLES且相对误差低于ADAPTIVE_ERROR_THRESHOLD时不再采样
+    bool isConverged() const;
+};
+
+/**
+ * @brief 整幅图像的采样统计，与Framebuffer相同按行连续存放，像素(x, y)的下标为y * width + x
+ */
+class PixelStatisticsBuffer
+{
+private:
+    int width, height;
+    std::vector<PixelStatistics> pixels;
+
+public:
+    PixelStatisticsBuffer(int width, int height);
+    ~PixelStatisticsBuffer();
+    int getWidth() const;
+    int getHeight() const;
+    PixelStatistics &at(int x, int y);
+    const PixelStatistics &at(int x, int y) const;
+};
+
+#endif
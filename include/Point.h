@@ -17,7 +17,6 @@ private:
 public:
     Point();
     Point(const QVector3D &position, const QVector3D &normal, const QVector2D &uv);
-    ~Point();
     QVector3D getPosition() const;
     QVector3D getNormal() const;
     QVector2D getUV() const;
@@ -0,0 +1,36 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <cstdint>
+
+/**
+ * @brief PCG32随机数生成器（O'Neill, PCG-XSH-RR），64位线性同余状态加上输出置换，
+ * 状态只有两个64位整数，可以在O(log n)时间内前进任意步数
+ */
+class PCG32
+{
+private:
+    uint64_t state, increment;
+
+public:
+    PCG32();
+    // 由初始状态与序列号设置生成器，序列号不同的生成器产生互不相关的序列
+    void seed(uint64_t initState, uint64_t sequence);
+    // 前进delta步，相当于丢弃delta个随机数
+    void advance(uint64_t delta);
+    uint32_t next()
+    {
+        uint64_t old = state;
+        state = old * 6364136223846793005ULL + increment;
+        uint32_t xorshifted = (uint32_t)(((old >> 18u) ^ old) >> 27u);
+        uint32_t rotation = (uint32_t)(old >> 59u);
+        return (xorshifted >> rotation) | (xorshifted << ((~rotation + 1u) & 31u));
+    }
+    // [0,1)均匀分布，取高24位以保证结果严格小于1
+    float nextFloat()
+    {
+        return (float)(next() >> 8) * (1.0f / 16777216.0f);
+    }
+};
+
+#endif
@@ -1,7 +1,11 @@
 #ifndef RAY_H
 #define RAY_H
 
+#include <cfloat>
+
 #include <QVector3D>
+
+#include "ConfigHelper.h"
 /**
  * @brief 光线类
  *
@@ -11,13 +15,22 @@ class Ray
 private:
     // 原点以及方向
     QVector3D origin, direction;
+    // 方向的倒数，用于与AABB求交
+    QVector3D invDirection;
+    // 有效的参数区间[tmin, tmax]
+    float tmin, tmax;
 
 public:
     // 根据起点和方向构建射线
-    Ray(const QVector3D &origin, const QVector3D &direction);
+    Ray(const QVector3D &origin, const QVector3D &direction, const float tmin = EPSILON, const float tmax = FLT_MAX);
     ~Ray();
     QVector3D getOrigin() const;
     QVector3D getDirection() const;
+    QVector3D getInvDirection() const;
+    float getTMin() const;
+    float getTMax() const;
+    // 缩小参数区间的上限（已找到更近的交点时）
+    void setTMax(const float t);
     // 根据射线参数值获取对应点
     QVector3D point(const float t) const;
     // 根据法向量求入射光线镜面反射光线
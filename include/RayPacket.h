@@ -0,0 +1,87 @@
+#ifndef RAY_PACKET_H
+#define RAY_PACKET_H
+
+#include <cfloat>
+#include <cstdint>
+#include <vector>
+
+#include <QVector3D>
+
+#include "ConfigHelper.h"
+#include "AABB.h"
+#include "Ray.h"
+#include "HitRecord.h"
+
+/**
+ * @brief 光线包，将一块相邻像素的主光线以SoA形式存放，便于用SIMD指令同时与多条光线求交
+ *
+ * 所有光线在每个轴上方向的符号都相同时称为相干光线包，此时可以用区间算术得到包围所有光线的视锥，
+ * 在内部节点先用视锥一次剔除整个光线包，再逐条光线求交
+ */
+class RayPacket
+{
+public:
+    // 最多容纳8x8条光线，活跃光线用64位掩码表示
+    static const int MAX_SIZE = 64;
+
+private:
+    int size;
+    // 方向符号一致时为true
+    bool coherent;
+    // 每条光线的原点、方向、方向的倒数（分量为0时用足够大的有限值代替）与参数区间，不足4的倍数的部分不参与求交
+    alignas(16) float origin[3][MAX_SIZE];
+    alignas(16) float direction[3][MAX_SIZE];
+    alignas(16) float invDirection[3][MAX_SIZE];
+    alignas(16) float tmin[MAX_SIZE];
+    alignas(16) float tmax[MAX_SIZE];
+    // 视锥：各轴原点与方向倒数的取值区间，方向为负时近平面为最大值
+    float originMin[3], originMax[3], invMin[3], invMax[3], minTMin;
+    int sign[3];
+    // 平均方向，用于决定子节点的访问顺序
+    QVector3D meanDirection;
+    // 所有光线方向与平均方向夹角余弦的最小值
+    float spread;
+
+public:
+    RayPacket(const std::vector<Ray> &rays);
+    ~RayPacket();
+    int getSize() const;
+    bool isCoherent() const;
+    // 光线方向与平均方向夹角余弦的最小值，越接近1光线包越窄
+    float getSpread() const;
+    // 所有光线对应的掩码
+    uint64_t getMask() const;
+    Ray getRay(int i) const;
+    float getTMax(int i) const;
+    const float *getOrigin(int axis) const;
+    const float *getDirection(int axis) const;
+    const float *getTMin() const;
+    /**
+     * @brief 光线包与AABB求交，先用视锥剔除整个光线包，再用SIMD逐条光线求交
+     *
+     * @param aabb 输入包围盒
+     * @param mask 参与求交的光线掩码
+     * @param t 每条光线当前最近交点的t值
+     * @return uint64_t 与包围盒相交的光线掩码
+     */
+    uint64_t intersect(const AABB &aabb, uint64_t mask, const float *t) const;
+    // 包围盒中心沿平均方向的距离，较小者先访问
+    float order(const AABB &aabb) const;
+};
+
+/**
+ * @brief 光线包的交点记录，以SoA形式存放，t同时作为每条光线的tmax
+ */
+struct HitPacket
+{
+    alignas(16) float t[RayPacket::MAX_SIZE];
+    alignas(16) float u[RayPacket::MAX_SIZE];
+    alignas(16) float v[RayPacket::MAX_SIZE];
+    int mesh[RayPacket::MAX_SIZE];
+    int primitive[RayPacket::MAX_SIZE];
+
+    HitPacket(const RayPacket &packet);
+    HitRecord getRecord(int i) const;
+};
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <cstdint>
+#include <memory>
+
+#include "ConfigHelper.h"
+#include "Random.h"
+
+/**
+ * @brief 采样器接口：为每个样本（像素坐标, 样本序号）生成一个高维点，每次next()取下一维
+ *
+ * 维度的划分由调用者决定：相机从第0维开始，路径从RANDOM_PATH_DIMENSION开始，
+ * 每次弹射占用RANDOM_BOUNCE_DIMENSIONS维，通过setDimension跳到对应位置，
+ * 使不同样本中同一维总是用于同一个采样决策，低差异序列才能发挥作用
+ */
+class Sampler
+{
+protected:
+    uint32_t x, y, index, dimension;
+    // 由像素坐标与RANDOM_SEED得到的哈希值，用于各实现的随机化
+    uint32_t pixelSeed;
+    // 样本开始或维度跳转时调用，供实现更新内部状态
+    virtual void restart();
+
+public:
+    Sampler();
+    virtual ~Sampler();
+    // 开始像素(x, y)的第sample个样本，从第dimension维开始取值
+    void start(uint32_t x, uint32_t y, uint32_t sample, uint32_t dimension);
+    // 跳到第dimension维
+    void setDimension(uint32_t dimension);
+    // 当前维度的[0,1)取值，随后维度加一
+    virtual float next() = 0;
+};
+
+// 独立的伪随机数（PCG32），作为对照与默认实现
+class RandomSampler : public Sampler
+{
+private:
+    PCG32 generator;
+    void restart() override;
+
+public:
+    float next() override;
+};
+
+// Owen置乱的Sobol序列（Burley 2020）：用前两维Sobol序列组成二维点，每对维度使用独立置乱的样本序号，
+// 因此任意多的维度都只需要前两维的生成矩阵，每一对维度的投影都是(0,2)序列
+class SobolSampler : public Sampler
+{
+private:
+    // 当前一对维度的取值，两维共用同一次计算
+    uint32_t cachedPair;
+    float cached[2];
+    void restart() override;
+
+public:
+    SobolSampler();
+    float next() override;
+};
+
+// Halton序列：第d维使用第d个素数为底的根逆，每个像素每一维的各位数字有独立的随机置换，
+// 超出素数表的维度退化为哈希随机数
+class HaltonSampler : public Sampler
+{
+public:
+    float next() override;
+};
+
+// 蓝噪声抖动：所有像素使用同一个Owen置乱的Sobol序列，再按每维错开的蓝噪声掩码做Cranley-Patterson旋转，
+// 相邻像素的误差互不相关且集中在高频，同样样本数下噪声在视觉上更均匀
+class BlueNoiseSampler : public Sampler
+{
+private:
+    // 当前一对维度的取值，两维共用同一次计算
+    uint32_t cachedPair;
+    float cached[2];
+    void restart() override;
+
+public:
+    BlueNoiseSampler();
+    float next() override;
+};
+
+// 按类型创建采样器
+std::unique_ptr<Sampler> createSampler(SamplerType type);
+
+// 当前线程的采样器，类型为SAMPLER_TYPE，randomUniform()从中取值
+Sampler &threadSampler();
+
+// 开始当前线程的一个样本，同一像素的同一样本无论由哪个线程、以何种顺序渲染，得到的取值都完全相同
+void startSample(uint32_t x, uint32_t y, uint32_t sample, uint32_t dimension);
+
+// 当前线程的采样器跳到第dimension维
+void setSampleDimension(uint32_t dimension);
+
+#endif
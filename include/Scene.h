@@ -7,6 +7,9 @@
 #include <algorithm>
 #include <vector>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <functional>
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
@@ -29,7 +32,17 @@
 #include "Material.h"
 #include "Texture.h"
 #include "Mesh.h"
+#include "Emitter.h"
+#include "PixelStatistics.h"
+#include "TileScheduler.h"
+#include "Framebuffer.h"
+#include "Denoiser.h"
+#include "AliasTable.h"
+#include "BVHBuilder.h"
+#include "BVHTraversal.h"
+#include "SceneCache.h"
 #include "Ray.h"
+#include "RayPacket.h"
 #include "camera.h"
 #include <spdlog/spdlog.h>
 
@@ -39,44 +52,89 @@
 class Scene
 {
 private:
+    // 从缓存加载时的文件映射，网格的三角形、BVH与纹理都直接引用其中的数据，需要比网格活得更久
+    std::shared_ptr<MappedFile> cacheFile;
+    // 材料表，下标与aiScene中的材质下标一致，网格通过下标引用
+    std::vector<Material> materials;
     // 物体网格序列
     std::vector<Mesh> meshes;
-    // 光源网格集合
-    std::vector<Mesh> light_meshes;
-    // 光源面积
-    float lightarea;
+    // 顶层BVH，以每个网格的aabb为图元，叶节点中存储网格下标
+    CacheArray<BVHNode> topNodes;
+    CacheArray<int> topIndices;
+    // 所有自发光网格的三角形，以及按功率（辐射度*面积）采样的别名表
+    std::vector<Emitter> emitters;
+    AliasTable emitterTable;
+    // 每个网格第一个三角形在emitters中的下标，非发光网格为-1，用于由交点找到对应的光源
+    std::vector<int> emitterOffsets;
+    // FRAMEBUFFER_PER_THREAD时每个线程私有的累积缓冲区，在多次render之间复用，每轮只合并并清零渲染过的块
+    mutable std::vector<Framebuffer> threadFrames;
     // 阈值方法，默认为true，即平等法
     bool threshold_method;
     //利用assimp 读取obj文件和mtl文件时的处理函数
-    void processNode(const aiNode *node, const aiScene *scene, const std::string &directory,std::map<std::string,QVector3D> lightmap);
-    Mesh processMesh(const aiMesh *mesh, const aiScene *scene, const std::string &directory,std::map<std::string,QVector3D> lightmap) const;
+    void processNode(const aiNode *node, const aiScene *scene, const std::string &directory);
+    Mesh processMesh(const aiMesh *mesh, const aiScene *scene, const std::string &directory) const;
+    Material processMaterial(const aiMaterial *material, const std::map<std::string, QVector3D> &lightmap) const;
     Texture processTexture(const aiMaterial *material, const std::string &directory) const;
+    // 在所有网格读取完毕后收集发光三角形并构建光源采样表
+    void buildEmitters();
+    // 在所有网格读取完毕后构建顶层BVH
+    void buildTopLevel();
+    // 按方向卦限与起点所在网格单元计算排序键，得到光线流的求交顺序
+    void sortStream(const std::vector<Ray> &rays, std::vector<int> &order) const;
+    // 读取与写入场景缓存，缓存头中的哈希或构建参数与当前不一致时读取失败
+    bool loadCache(const std::string &cachePath, uint64_t hash);
+    void saveCache(const std::string &cachePath, uint64_t hash) const;
 
     /**********************************************************************************************/
     /**
-     * @brief 光追函数，计算光线与场景中物体网格可能的交点
+     * @brief 光追函数，通过顶层BVH计算光线与场景中物体网格的最近交点，
+     * 遍历过程中只记录t、网格与三角形下标以及重心坐标
      *
      * @param ray 输入光线
-     * @param t 输出交点对应光线的参数t
-     * @param point 输出交点的位置
-     * @param material 输出交点对应的网格材料
+     * @param hit 输出交点记录
+     * @return bool 是否有交点
+     */
+    bool intersect(const Ray &ray, HitRecord &hit) const;
+
+    /**********************************************************************************************/
+    /**
+     * @brief 光线包版本的光追函数，用于同一像素块的主光线；光线包不相干时逐条光线求交
+     *
+     * @param packet 输入光线包
+     * @param hits 输出每条光线的交点记录
+     */
+    void intersect(const RayPacket &packet, HitRecord *hits) const;
+
+    /**********************************************************************************************/
+    /**
+     * @brief 根据最终的交点记录插值交点属性并读取纹理，材料通过getMaterial(hit)单独获取
+     *
+     * @param ray 产生交点的光线
+     * @param hit 交点记录
+     * @param point 输出交点的位置、法线和纹理坐标
      * @param color 输出交点对应的物体纹理
      */
-    void trace(const Ray &ray, float &t, Point &point, Material &material, QVector3D &color) const;
+    void resolve(const Ray &ray, const HitRecord &hit, Point &point, QVector3D &color) const;
+    // 交点所在网格的材料
+    const Material &getMaterial(const HitRecord &hit) const;
     
+    // 按功率选择发光三角形并在其上采样，计算Phong材料着色点的直接光照，reflection为入射光线的镜面反射方向
+    QVector3D directLighting(const Point &point, const QVector3D &reflection, const Material &material, const QVector3D &color) const;
+    // brdf采样的光线击中发光三角形时的自发射光，按光源采样的pdf计算MIS权重，brdfPdf为生成该光线的立体角pdf
+    QVector3D emission(const Ray &ray, const HitRecord &hit, float brdfPdf) const;
+
     /**********************************************************************************************/
     /**
-     * @brief  着色函数，在光线的截交点进行着色绘制
+     * @brief 路径积分函数，从相机光线的交点开始迭代地弹射，累积路径通量与辐射度
      *
-     * @param ray 输入光线
-     * @param point 输入着色点
-     * @param material 输入材料
-     * @param color 输入颜色
-     * @param bounce 输入光线弹射次数
+     * @param cameraRay 输入相机光线
+     * @param cameraHit 输入相机光线的交点记录
      * @return QVector3D 输出的最终渲染的颜色
      */
-    QVector3D shade(const Ray &ray, const Point &point, const Material &material, const QVector3D &color, const int bounce) const;
-    
+    QVector3D integrate(const Ray &cameraRay, const HitRecord &cameraHit) const;
+    // 对一个像素块中的给定像素（不超过RayPacket::MAX_SIZE个）各采样一次，主光线作为光线包一起求交，结果按pixels的顺序写入radiance，
+    // indices为每个像素本次的样本序号，与像素坐标一起决定该样本的随机数；first不为空时同时写入每个样本第一个交点的AOV
+    void sampleTile(const Camera &cam, const std::vector<std::pair<int, int>> &pixels, const uint32_t *indices, QVector3D *radiance, FirstHit *first = nullptr) const;
 
 public:
     Scene();
@@ -88,9 +146,57 @@ public:
      * @brief 场景采样函数，对每个像素点进行场景采样后形成一幅图像
      * 
      * @param cam 输入的相机模型
-     * @param sum 输出的结果图像
+     * @param frame 输出的累积缓冲区，每个像素累加一个样本
+     */
+    void sample(const Camera &cam, Framebuffer &frame);
+
+    /**
+     * @brief 分块渲染：图像按RENDER_TILE_SIZE划分为渲染块，由TileScheduler按Morton顺序分给各线程并支持窃取，
+     * 每个任务对一个块连续采样samples次，块之间互不依赖，整个过程只有一次并行区域的同步
+     *
+     * @param cam 输入的相机模型
+     * @param frame 输出的累积缓冲区，每个像素累加samples个样本；FRAMEBUFFER_PER_THREAD为true时
+     * 各线程先写入私有的缓冲区，全部块完成后再合并，此时onTileDone中还看不到该块的结果
+     * @param samples 每个像素的采样次数
+     * @param onTileDone 每个块完成时在渲染线程中调用，可用于逐块输出或预览
+     * @param aovs 不为空时同时累积降噪用的反照率、法线与深度，样本数与frame相同
+     */
+    void render(const Camera &cam, Framebuffer &frame, int samples, const std::function<void(const Tile &)> &onTileDone = nullptr, AOVBuffers *aovs = nullptr) const;
+
+    /**
+     * @brief 自适应采样的一轮，只对尚未收敛（见PixelStatistics::isConverged）的像素采样，
+     * 每个像素的样本数与其相对误差超出ADAPTIVE_ERROR_THRESHOLD的倍数成正比（至多ADAPTIVE_PASS_SAMPLES），
+     * 样本集中在误差大的像素上，已收敛的背景等像素不再消耗计算
+     *
+     * @param cam 输入的相机模型
+     * @param pixels 输入输出每个像素的采样统计，用于判断是否收敛
+     * @param frame 输出的累积缓冲区，样本同时累加到其中，A通道即每个像素的样本数
+     * @param maxSamples 每个像素的样本数上限
+     * @param aovs 不为空时同时累积降噪用的辅助缓冲区
+     * @return int 本轮的样本总数，为0时所有像素均已收敛或达到上限
+     */
+    int sampleAdaptive(const Camera &cam, PixelStatisticsBuffer &pixels, Framebuffer &frame, int maxSamples, AOVBuffers *aovs = nullptr);
+
+    /**********************************************************************************************/
+    /**
+     * @brief 遮挡查询，判断origin与target之间是否有物体，找到任意一个交点即返回，
+     * 不计算交点属性，也不读取材料和纹理
+     *
+     * @param origin 起点（着色点）
+     * @param target 终点（如光源上的采样点），终点所在的表面本身不算遮挡
+     * @return bool 是否被遮挡
+     */
+    bool occluded(const QVector3D &origin, const QVector3D &target) const;
+
+    /**********************************************************************************************/
+    /**
+     * @brief 批量光追函数，用于一批互不相关的光线（如同一次弹射的所有次级光线），
+     * 光线较多时先按方向卦限与起点位置排序，使相邻求交的光线经过相近的BVH路径
+     *
+     * @param rays 输入光线
+     * @param hits 输出与rays一一对应的交点记录
      */
-    void sample(const Camera &cam, std::vector<std::vector<QVector3D>> &sum);
+    void traceStream(const std::vector<Ray> &rays, std::vector<HitRecord> &hits) const;
 
 };
 
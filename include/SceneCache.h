@@ -0,0 +1,218 @@
+#ifndef SCENE_CACHE_H
+#define SCENE_CACHE_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <utility>
+#include <type_traits>
+
+#include "ConfigHelper.h"
+
+/**
+ * @brief 只读的文件内存映射，析构时解除映射（Windows下退化为整体读入内存）
+ */
+class MappedFile
+{
+private:
+    const char *data;
+    size_t length;
+    std::vector<char> buffer;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+public:
+    MappedFile(const std::string &path);
+    ~MappedFile();
+    // 文件不存在或无法映射时为false
+    bool isOpen() const;
+    const char *getData() const;
+    size_t getSize() const;
+};
+
+/**
+ * @brief 只读数组，数据或者由自身持有，或者直接引用缓存文件映射中的内存
+ *
+ * 引用映射内存时不做拷贝，调用方需要保证映射比数组（及其副本）活得更久
+ */
+template <class T>
+class CacheArray
+{
+private:
+    // 自身持有的数据，引用映射内存时为空
+    std::vector<T> owned;
+    const T *elements;
+    size_t count;
+    bool mapped;
+
+public:
+    CacheArray() : elements(nullptr), count(0), mapped(false) {}
+    CacheArray(std::vector<T> values) : owned(std::move(values)), elements(owned.data()), count(owned.size()), mapped(false) {}
+    CacheArray(const T *values, size_t count) : elements(values), count(count), mapped(true) {}
+    CacheArray(const CacheArray &other) : owned(other.owned), elements(other.mapped ? other.elements : owned.data()), count(other.count), mapped(other.mapped) {}
+    CacheArray(CacheArray &&other) noexcept : owned(std::move(other.owned)), elements(other.mapped ? other.elements : owned.data()), count(other.count), mapped(other.mapped)
+    {
+        other.elements = nullptr;
+        other.count = 0;
+    }
+
+    CacheArray &operator=(CacheArray other)
+    {
+        owned.swap(other.owned);
+        std::swap(count, other.count);
+        std::swap(mapped, other.mapped);
+        elements = mapped ? other.elements : owned.data();
+        return *this;
+    }
+
+    size_t size() const
+    {
+        return count;
+    }
+
+    bool empty() const
+    {
+        return count == 0;
+    }
+
+    const T *data() const
+    {
+        return elements;
+    }
+
+    const T &operator[](size_t index) const
+    {
+        return elements[index];
+    }
+
+    const T *begin() const
+    {
+        return elements;
+    }
+
+    const T *end() const
+    {
+        return elements + count;
+    }
+};
+
+/**
+ * @brief 缓存文件写入器，数组按16字节对齐写入，使加载时可以直接在映射内存上访问
+ *
+ * 先写入临时文件，commit时再重命名为目标文件，避免其他进程读到写了一半的缓存
+ */
+class CacheWriter
+{
+private:
+    std::string path, tempPath;
+    std::ofstream stream;
+    size_t position;
+    void pad();
+
+public:
+    CacheWriter(const std::string &path);
+    ~CacheWriter();
+    bool fail() const;
+    // 写入完毕后替换目标文件
+    bool commit();
+
+    template <class T>
+    void write(const T &value)
+    {
+        stream.write((const char *)&value, sizeof(T));
+        position += sizeof(T);
+    }
+
+    // 先写入元素个数，再对齐后写入数组内容
+    template <class T>
+    void writeArray(const T *values, size_t count)
+    {
+        write<uint64_t>(count);
+        pad();
+        stream.write((const char *)values, count * sizeof(T));
+        position += count * sizeof(T);
+    }
+
+    template <class T>
+    void writeArray(const std::vector<T> &values)
+    {
+        writeArray(values.data(), values.size());
+    }
+
+    template <class T>
+    void writeArray(const CacheArray<T> &values)
+    {
+        writeArray(values.data(), values.size());
+    }
+};
+
+/**
+ * @brief 缓存文件读取器，按写入顺序读取；越界后进入失败状态，之后的读取都返回空值
+ */
+class CacheReader
+{
+private:
+    const char *data;
+    size_t size, position;
+    bool failed;
+    // 检查剩余空间，不足时进入失败状态
+    bool require(size_t bytes);
+
+public:
+    CacheReader(const char *data, size_t size);
+    bool fail() const;
+    // 读取的内容不合法（如下标越界）时由调用方标记为失败
+    void invalidate();
+
+    template <class T>
+    T read()
+    {
+        T value = T();
+        if (require(sizeof(T)))
+        {
+            std::memcpy(&value, data + position, sizeof(T));
+            position += sizeof(T);
+        }
+        return value;
+    }
+
+    // 返回指向映射内存中数组的指针，不做拷贝；count输出元素个数
+    template <class T>
+    const T *view(size_t &count)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "cached arrays are used in place and must be trivially copyable");
+        count = (size_t)read<uint64_t>();
+        position = (position + 15) & ~(size_t)15;
+        if (failed || position > size || count > (size - position) / sizeof(T))
+        {
+            failed = true;
+            count = 0;
+            return nullptr;
+        }
+        const T *values = (const T *)(data + position);
+        position += count * sizeof(T);
+        return values;
+    }
+
+    // 直接引用映射内存中的数组，失败时为空数组
+    template <class T>
+    CacheArray<T> viewArray()
+    {
+        size_t count;
+        const T *values = view<T>(count);
+        return CacheArray<T>(values, count);
+    }
+};
+
+/**
+ * @brief 计算场景文件（obj、其引用的mtl以及光源xml）内容的64位哈希，作为缓存的键
+ *
+ * @param meshPath obj文件路径
+ * @param xmlPath 光源xml文件路径
+ * @return uint64_t 哈希值
+ */
+uint64_t hashSceneFiles(const std::string &meshPath, const std::string &xmlPath);
+
+#endif
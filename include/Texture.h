@@ -7,6 +7,7 @@
 #include <QVector2D>
 
 #include "UtilsHelper.h"
+#include "SceneCache.h"
 /**
  * @brief 纹理类
  *
@@ -19,9 +20,13 @@ private:
 
 public:
     Texture(const QImage &image);
+    // 从场景缓存中读取纹理，图像直接引用映射内存中的像素，映射需要在纹理使用期间保持有效
+    Texture(CacheReader &reader);
     ~Texture();
     // 纹理是否为空
     bool isNull() const;
+    // 将解码后的像素写入场景缓存
+    void save(CacheWriter &writer) const;
     // 根据uv坐标获取纹理
     QVector3D color(const QVector2D &uv) const;
 };
@@ -0,0 +1,39 @@
+#ifndef TILE_SCHEDULER_H
+#define TILE_SCHEDULER_H
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief 图像上的一个渲染块，像素范围为[x0, x1) x [y0, y1)
+ */
+struct Tile
+{
+    int x0, y0, x1, y1;
+};
+
+/**
+ * @brief 渲染块调度器：图像被划分为size x size的块并按Morton曲线排序，
+ * 排序后的块按连续区间分给各线程的双端队列，线程从自己队列的头部取块，
+ * 队列为空时从其它线程队列的尾部窃取，使相邻的块尽量由同一线程连续渲染
+ */
+class TileScheduler
+{
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Tile> tiles;
+    };
+    std::vector<std::unique_ptr<Queue>> queues;
+
+public:
+    TileScheduler(int width, int height, int size, int threads);
+    ~TileScheduler();
+    // 为线程thread取下一个块，所有块都已分出时返回false
+    bool next(int thread, Tile &tile);
+};
+
+#endif
@@ -26,14 +26,17 @@ private:
 
 public:
     Triangle(const Point &p0, const Point &p1, const Point &p2);
-    ~Triangle();
     // 获取重心
     QVector3D getCenter() const;
+    // 获取第index（0~2）个顶点
+    Point getVertex(int index) const;
     // 面积
     float area() const;
     // 获取AABB
     AABB aabb() const;
-    // 三角形截交判断
+    // 根据交点位置与重心坐标(u, v)插值出法线与纹理坐标
+    Point interpolate(const QVector3D &position, float u, float v) const;
+    // 三角形截交判断，只接受位于光线[tmin, tmax]区间内的交点
     void trace(const Ray &ray, float &t, Point &point) const;
     // 从三角形中随机采样
     Point sample() const;
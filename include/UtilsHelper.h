@@ -1,9 +1,8 @@
 #ifndef UTILS_HELPER_H
 #define UTILS_HELPER_H
 
-#include <random>
-#include <ctime>
 #include <cmath>
+#include <algorithm>
 
 #include <time.h>
 #ifdef _WIN32
@@ -16,11 +15,7 @@
 #include <QColor>
 
 #include "ConfigHelper.h"
-
-// 随机数引擎
-static std::default_random_engine engine(std::time(nullptr));
-// 随机数分布
-static std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+#include "Sampler.h"
 
 static QVector3D colorToVector(const QColor &color)
 {
@@ -48,19 +43,17 @@ static void calculateTangentSpace(const QVector3D &normal, QVector3D &tangent, Q
     bitangent = QVector3D::crossProduct(tangent, normal);
 }
 
-//[0,1]均匀分布随机采样
-static float randomUniform()
+//[0,1)均匀分布采样，取当前线程采样器的下一维
+static inline float randomUniform()
 {
-    return uniform(engine);
+    return threadSampler().next();
 }
 
-// 使用分层采样来对每个像素点进行采样
+// 像素内的采样位置，由采样器的两维给出，低差异采样器在多次迭代之间自然地分层
 static void samplePixel(float &x, float &y)
 {
-    int xt = (int)(randomUniform() * STRATIFY_SIZE);
-    int yt = (int)(randomUniform() * STRATIFY_SIZE);
-    x = ((float)xt + randomUniform()) / STRATIFY_SIZE;
-    y = ((float)yt + randomUniform()) / STRATIFY_SIZE;
+    x = randomUniform();
+    y = randomUniform();
 }
 // 半球积分采样
 // 对于均匀采样：
@@ -75,11 +68,12 @@ static void samplePixel(float &x, float &y)
 // 对于余弦加权镜面反射
 //  pdf=(n+1)/(2*pi)*cos(theta)^n
 // 最终得到theta=acos(random^(1/n))
-static void sampleHemisphere(const float exp, float &theta, float &phi)
+// u1,u2为[0,1)内的两维采样值
+static void sampleHemisphere(const float exp, float u1, float u2, float &theta, float &phi)
 {
 
-    theta = std::acos(std::pow(randomUniform(), 1.0f / (exp + 1.0f)));
-    phi = randomUniform() * PI * 2.0f;
+    theta = std::acos(std::pow(u1, 1.0f / (exp + 1.0f)));
+    phi = u2 * PI * 2.0f;
 }
 
 // 获取cpu时间
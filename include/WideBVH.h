@@ -0,0 +1,89 @@
+#ifndef WIDE_BVH_H
+#define WIDE_BVH_H
+
+#include <cfloat>
+#include <cstdint>
+#include <vector>
+
+#include "ConfigHelper.h"
+#include "AABB.h"
+#include "BVHBuilder.h"
+#include "Ray.h"
+#include "SceneCache.h"
+
+/**
+ * @brief 多叉BVH节点，N个子节点的包围盒以SoA形式存放，便于一次SIMD指令同时与所有子节点求交
+ */
+template <int N>
+struct WideBVHNode
+{
+    // bounds[0..2]为各子节点x、y、z的最小值，bounds[3..5]为最大值，空槽位的最小值为FLT_MAX、最大值为-FLT_MAX
+    float bounds[6][N];
+    // 内部子节点：节点下标；叶子节点：图元索引起始位置
+    int32_t child[N];
+    // 叶子节点的图元数量，内部子节点为0，空槽位为-1
+    int32_t count[N];
+};
+
+/**
+ * @brief 与多叉BVH求交时预先计算的光线数据
+ */
+struct WideRay
+{
+    float origin[3];
+    // 方向的倒数，分量为0时用足够大的有限值代替，避免0*inf产生NaN
+    float invDirection[3];
+    // 方向分量为负时近平面为最大值
+    int sign[3];
+    float tmin;
+
+    WideRay(const Ray &ray);
+};
+
+/**
+ * @brief 由二叉BVH塌缩得到的N叉BVH（N为4时使用SSE，N为8时使用AVX）
+ */
+template <int N>
+class WideBVH
+{
+private:
+    CacheArray<WideBVHNode<N>> nodes;
+    // 将以binary[index]为根的二叉子树塌缩为一个N叉节点并追加到built中，返回节点下标
+    static int collapse(const std::vector<BVHNode> &binary, int index, std::vector<WideBVHNode<N>> &built);
+
+public:
+    WideBVH();
+    // 从二叉BVH构建，每次展开面积最大的内部子节点，直到填满N个槽位
+    WideBVH(const std::vector<BVHNode> &binary);
+    // 直接引用场景缓存中已塌缩好的节点
+    WideBVH(CacheReader &reader);
+    ~WideBVH();
+    void save(CacheWriter &writer) const;
+    bool empty() const;
+    // 子节点下标是否都指向之后的节点、叶节点的图元区间是否都在[0, primitives)内，用于检查缓存
+    bool isValid(size_t primitives) const;
+    const WideBVHNode<N> &getNode(int index) const;
+    /**
+     * @brief 光线与节点的N个子节点同时求交
+     *
+     * @param node 输入节点
+     * @param ray 输入光线
+     * @param tmax 当前最近交点的t值
+     * @param tEntry 输出每个子节点的进入距离
+     * @return int 相交子节点的位掩码
+     */
+    static int intersect(const WideBVHNode<N> &node, const WideRay &ray, float tmax, float *tEntry);
+};
+
+// 有对应指令集时intersect使用SIMD实现（定义在WideBVH.cpp中），特化必须在使用前对所有翻译单元可见
+#if defined(__SSE__)
+template <>
+int WideBVH<4>::intersect(const WideBVHNode<4> &node, const WideRay &ray, float tmax, float *tEntry);
+#endif
+
+#if defined(__AVX__)
+template <>
+int WideBVH<8>::intersect(const WideBVHNode<8> &node, const WideRay &ray, float tmax, float *tEntry);
+#endif
+
+#endif
\ No newline at end of file
@@ -7,8 +7,6 @@ AABB::AABB() : x0(FLT_MAX),
                z0(FLT_MAX),
                z1(-FLT_MAX) {}
 
-AABB::~AABB() {}
-
 void AABB::add(const QVector3D &point)
 {
     x0 = std::min(x0, point.x());
@@ -29,6 +27,23 @@ void AABB::combine(const AABB &aabb)
     z1 = std::max(z1, aabb.z1);
 }
 
+void AABB::intersect(const AABB &aabb)
+{
+    x0 = std::max(x0, aabb.x0);
+    x1 = std::min(x1, aabb.x1);
+    y0 = std::max(y0, aabb.y0);
+    y1 = std::min(y1, aabb.y1);
+    z0 = std::max(z0, aabb.z0);
+    z1 = std::min(z1, aabb.z1);
+    if (isEmpty())
+        *this = AABB();
+}
+
+bool AABB::isEmpty() const
+{
+    return x0 > x1 || y0 > y1 || z0 > z1;
+}
+
 float AABB::rangeX() const
 {
     return x1 - x0;
@@ -44,10 +59,35 @@ float AABB::rangeZ() const
     return z1 - z0;
 }
 
-bool AABB::trace(const Ray &ray) const
+QVector3D AABB::getMin() const
+{
+    return QVector3D(x0, y0, z0);
+}
+
+QVector3D AABB::getMax() const
+{
+    return QVector3D(x1, y1, z1);
+}
+
+QVector3D AABB::getCenter() const
+{
+    return QVector3D(x0 + x1, y0 + y1, z0 + z1) * 0.5f;
+}
+
+float AABB::surfaceArea() const
+{
+    // 空包围盒的面积为0
+    if (isEmpty())
+        return 0.0f;
+    float x = rangeX(), y = rangeY(), z = rangeZ();
+    return 2.0f * (x * y + y * z + z * x);
+}
+
+float AABB::trace(const Ray &ray) const
 {
-    QVector3D o = ray.getOrigin(), d = ray.getDirection();
-    float t0 = 0.0f, t1 = FLT_MAX;
+    QVector3D o = ray.getOrigin(), d = ray.getDirection(), inv = ray.getInvDirection();
+    // 在光线的有效区间[tmin, tmax]内求交，tmax可能已被更近的交点缩小
+    float t0 = ray.getTMin(), t1 = ray.getTMax();
     // 射线若与AABB相交，则必然在每个轴上均与其相交，考虑单一轴进行推理：
     // 若将在该轴射线方向上将AABB的近极值点定义为x0，对应t值为t0，远极值点定义为x1，对应t值为t1，则t0<=t1，但t0与t1不一定大于0
     // 考虑到射线与AABB相交只可能发生在射线参数t>0的情况下：
@@ -58,30 +98,31 @@ bool AABB::trace(const Ray &ray) const
 
     // 若射线在某个轴上的分量为0，则视为与该轴平行，此时只需要考虑极值情况：
     // 即射线的原点是否位于AABB该坐标轴的范围之外
-    // 否则进行上述判断
+    // 否则进行上述判断，除法用预先计算的方向倒数代替
     if (std::fabs(d.x()) > EPSILON)
     {
-        t0 = std::max(t0, ((d.x() > 0 ? x0 : x1) - o.x()) / d.x()); // t0>=0x'w
-        t1 = std::min(t1, ((d.x() > 0 ? x1 : x0) - o.x()) / d.x());
+        t0 = std::max(t0, ((d.x() > 0 ? x0 : x1) - o.x()) * inv.x());
+        t1 = std::min(t1, ((d.x() > 0 ? x1 : x0) - o.x()) * inv.x());
     }
     else if (o.x() < x0 || o.x() > x1)
-        return false;
+        return FLT_MAX;
 
     if (std::fabs(d.y()) > EPSILON)
     {
-        t0 = std::max(t0, ((d.y() > 0 ? y0 : y1) - o.y()) / d.y());
-        t1 = std::min(t1, ((d.y() > 0 ? y1 : y0) - o.y()) / d.y());
+        t0 = std::max(t0, ((d.y() > 0 ? y0 : y1) - o.y()) * inv.y());
+        t1 = std::min(t1, ((d.y() > 0 ? y1 : y0) - o.y()) * inv.y());
     }
     else if (o.y() < y0 || o.y() > y1)
-        return false;
+        return FLT_MAX;
 
     if (std::fabs(d.z()) > EPSILON)
     {
-        t0 = std::max(t0, ((d.z() > 0 ? z0 : z1) - o.z()) / d.z());
-        t1 = std::min(t1, ((d.z() > 0 ? z1 : z0) - o.z()) / d.z());
+        t0 = std::max(t0, ((d.z() > 0 ? z0 : z1) - o.z()) * inv.z());
+        t1 = std::min(t1, ((d.z() > 0 ? z1 : z0) - o.z()) * inv.z());
     }
     else if (o.z() < z0 || o.z() > z1)
-        return false;
+        return FLT_MAX;
 
-    return t0 <= t1;
+    // 返回进入AABB时的t值
+    return t0 <= t1 ? t0 : FLT_MAX;
 }
\ No newline at end of file
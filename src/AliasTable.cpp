@@ -0,0 +1,77 @@
+#include "AliasTable.h"
+
+#include <algorithm>
+
+AliasTable::AliasTable() : total(0.0f) {}
+
+// Vose的方法：将权重缩放为平均值为1，每次用一个不足1的槽位与一个超过1的槽位配对，
+// 超出部分补到不足的槽位中，直到所有槽位都恰好为1
+AliasTable::AliasTable(const std::vector<float> &weights) : total(0.0f)
+{
+    int n = (int)weights.size();
+    double sum = 0.0;
+    for (float weight : weights)
+        sum += std::max(weight, 0.0f);
+    if (n == 0 || sum <= 0.0)
+        return;
+    total = (float)sum;
+
+    entries.resize(n);
+    pdfs.resize(n);
+    std::vector<double> scaled(n);
+    std::vector<int> small, large;
+    for (int i = 0; i < n; i++)
+    {
+        pdfs[i] = (float)(std::max(weights[i], 0.0f) / sum);
+        scaled[i] = std::max(weights[i], 0.0f) / sum * n;
+        (scaled[i] < 1.0 ? small : large).push_back(i);
+    }
+    while (!small.empty() && !large.empty())
+    {
+        int less = small.back(), more = large.back();
+        small.pop_back();
+        entries[less].probability = (float)scaled[less];
+        entries[less].alias = more;
+        scaled[more] -= 1.0 - scaled[less];
+        if (scaled[more] < 1.0)
+        {
+            large.pop_back();
+            small.push_back(more);
+        }
+    }
+    // 剩余槽位由于舍入误差与1相差极小，直接视为1
+    for (int i : small)
+        entries[i] = {1.0f, i};
+    for (int i : large)
+        entries[i] = {1.0f, i};
+}
+
+AliasTable::~AliasTable() {}
+
+bool AliasTable::empty() const
+{
+    return entries.empty();
+}
+
+int AliasTable::size() const
+{
+    return (int)entries.size();
+}
+
+float AliasTable::getTotal() const
+{
+    return total;
+}
+
+float AliasTable::pdf(int i) const
+{
+    return pdfs[i];
+}
+
+// 不复用u*n的小数部分：u只有24位精度，n很大时小数部分只剩几位，选择概率会被量化而与pdf不一致
+int AliasTable::sample(float u, float v) const
+{
+    int n = (int)entries.size();
+    int i = std::min((int)((double)u * n), n - 1);
+    return v < entries[i].probability ? i : entries[i].alias;
+}
@@ -1,98 +1,380 @@
 #include "BVH.h"
-// BVH的递归构建过程
-// Top-down模式
-BVH::BVH(const std::vector<Triangle> &triangles)
-{
-    // 当前节点的aabb位包络所有子节点的aabb
-    for (const Triangle &triangle : triangles)
-        aabb.combine(triangle.aabb());
-    //小于BVH节点三角形分裂下限就不再进行分裂
-    if (triangles.size() <= BVH_LIMIT)
+
+#if defined(__SSE__)
+#include <immintrin.h>
+#endif
+
+BVH::BVH(const std::vector<Triangle> &triangles, BVHBuildMethod method)
+{
+    // 预先计算每个三角形的aabb与重心，构建过程只操作三角形索引
+    int n = (int)triangles.size();
+    std::vector<AABB> bounds(n);
+    std::vector<QVector3D> centers(n);
+#pragma omp parallel for if (n >= BVH_PARALLEL_THRESHOLD)
+    for (int i = 0; i < n; i++)
     {
-        this->triangles = triangles;
-        left = right = nullptr;
+        bounds[i] = triangles[i].aabb();
+        centers[i] = triangles[i].getCenter();
     }
-    else
+    BVHBuilder builder(bounds, centers, method);
+    // SBVH需要裁剪三角形，叶节点中同一个三角形可能被多次引用
+    std::vector<QVector3D> vertices;
+    if (method == BVH_BUILD_SBVH)
     {
-        // 选择最大轴物体数量中点进行划分
-        float x = aabb.rangeX(), y = aabb.rangeY(), z = aabb.rangeZ();
-        std::vector<Triangle> tempTriangles = triangles;
-        if (x >= y && x >= z)
-            std::sort(tempTriangles.begin(), tempTriangles.end(), compareByX);
-        else if (y >= x && y >= z)
-            std::sort(tempTriangles.begin(), tempTriangles.end(), compareByY);
-        else
-            std::sort(tempTriangles.begin(), tempTriangles.end(), compareByZ);
-        // 划分BVH
-        auto middle = tempTriangles.begin() + (tempTriangles.size() / 2);
-        std::vector<Triangle> leftTriangles(tempTriangles.begin(), middle);
-        std::vector<Triangle> rightTriangles(middle, tempTriangles.end());
-        left = new BVH(leftTriangles);
-        right = new BVH(rightTriangles);
+        vertices.resize(3 * n);
+        for (int i = 0; i < n; i++)
+            for (int k = 0; k < 3; k++)
+                vertices[3 * i + k] = triangles[i].getVertex(k).getPosition();
+        builder.setTriangles(vertices);
     }
+    std::vector<BVHNode> binary;
+    std::vector<int> order;
+    builder.build(binary, order);
+    if (BVH_WIDTH == 4)
+        bvh4 = WideBVH<4>(binary);
+    else if (BVH_WIDTH == 8)
+        bvh8 = WideBVH<8>(binary);
+    nodes = CacheArray<BVHNode>(std::move(binary));
+    indices = CacheArray<int>(std::move(order));
+    buildRecords(triangles);
+}
+
+BVH::BVH(size_t triangleCount, CacheReader &reader) : nodes(reader.viewArray<BVHNode>()),
+                                                       indices(reader.viewArray<int>()),
+                                                       records(reader.viewArray<TriangleRecord>()),
+                                                       bvh4(reader),
+                                                       bvh8(reader)
+{
+    // 缓存损坏时调用方会检查读取器状态并丢弃结果
+    if (!reader.fail() && !isValid(triangleCount))
+        reader.invalidate();
+}
+
+BVH::~BVH() {}
+
+void BVH::save(CacheWriter &writer) const
+{
+    writer.writeArray(nodes);
+    writer.writeArray(indices);
+    writer.writeArray(records);
+    bvh4.save(writer);
+    bvh8.save(writer);
+}
+
+bool BVH::isValid(size_t triangleCount) const
+{
+    if (indices.size() != records.size() || !isValidTree(nodes.data(), nodes.size(), records.size()))
+        return false;
+    for (int index : indices)
+        if (index < 0 || (size_t)index >= triangleCount)
+            return false;
+    return bvh4.isValid(records.size()) && bvh8.isValid(records.size());
+}
+
+AABB BVH::getAABB() const
+{
+    return nodes.empty() ? AABB() : nodes[0].aabb;
 }
 
-BVH::BVH(const BVH &bvh) : aabb(bvh.aabb),
-                           triangles(bvh.triangles),
-                           left(bvh.left == nullptr ? nullptr : new BVH(*bvh.left)),
-                           right(bvh.right == nullptr ? nullptr : new BVH(*bvh.right)) {}
+// 求交数据按叶节点顺序连续存放，遍历叶节点时顺序读取；SBVH中被重复引用的三角形会有多份
+void BVH::buildRecords(const std::vector<Triangle> &triangles)
+{
+    std::vector<TriangleRecord> built(indices.size());
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        const Triangle &triangle = triangles[indices[i]];
+        QVector3D p0 = triangle.getVertex(0).getPosition();
+        built[i].v0 = p0;
+        built[i].e1 = triangle.getVertex(1).getPosition() - p0;
+        built[i].e2 = triangle.getVertex(2).getPosition() - p0;
+    }
+    records = CacheArray<TriangleRecord>(std::move(built));
+}
 
-BVH::~BVH()
+// 遍历只得到最近交点对应的三角形与重心坐标，交点的法线与纹理坐标由调用方在最后插值
+bool BVH::trace(const Ray &ray, HitRecord &hit) const
 {
-    delete left;
-    delete right;
+    float t = std::min(ray.getTMax(), hit.t), u = 0.0f, v = 0.0f;
+    int slot = -1;
+    if (!bvh4.empty())
+        traceWide(bvh4, ray, t, slot, u, v);
+    else if (!bvh8.empty())
+        traceWide(bvh8, ray, t, slot, u, v);
+    else
+        traceBinary(ray, t, slot, u, v);
+    if (slot < 0)
+        return false;
+    hit.t = t;
+    hit.primitive = indices[slot];
+    hit.u = u;
+    hit.v = v;
+    return true;
 }
 
-bool BVH::compareByX(const Triangle &t0, const Triangle &t1)
+// 与Triangle::trace相同的MT算法（含背面剔除），但不构造交点，交点位于光线区间内时输出t与重心坐标
+static inline bool intersectRecord(const TriangleRecord &record, const QVector3D &o, const QVector3D &d, const Ray &ray, float &t, float &u, float &v)
 {
-    return t0.getCenter().x() < t1.getCenter().x();
+    QVector3D s = o - record.v0;
+    QVector3D s1 = QVector3D::crossProduct(s, record.e1);
+    QVector3D s2 = QVector3D::crossProduct(d, record.e2);
+    float w = QVector3D::dotProduct(record.e1, s2);
+    if (w < EPSILON)
+        return false;
+    t = QVector3D::dotProduct(record.e2, s1) / w;
+    if (!(t > ray.getTMin() && t < ray.getTMax()))
+        return false;
+    u = QVector3D::dotProduct(s, s2) / w;
+    v = QVector3D::dotProduct(d, s1) / w;
+    return u >= 0.0f && v >= 0.0f && u + v <= 1.0f;
 }
 
-bool BVH::compareByY(const Triangle &t0, const Triangle &t1)
+void BVH::traceTriangles(int offset, int count, Ray &ray, float &t, int &slot, float &u, float &v) const
 {
-    return t0.getCenter().y() < t1.getCenter().y();
+    QVector3D o = ray.getOrigin();
+    QVector3D d = ray.getDirection();
+    for (int i = offset; i < offset + count; i++)
+    {
+        float tTemp, uTemp, vTemp;
+        if (intersectRecord(records[i], o, d, ray, tTemp, uTemp, vTemp))
+        {
+            t = tTemp;
+            slot = i;
+            u = uTemp;
+            v = vTemp;
+            ray.setTMax(t);
+        }
+    }
 }
 
-bool BVH::compareByZ(const Triangle &t0, const Triangle &t1)
+// 光线与二叉BVH截交计算，遍历顺序见traverseClosest
+void BVH::traceBinary(const Ray &ray, float &t, int &slot, float &u, float &v, int root) const
 {
-    return t0.getCenter().z() < t1.getCenter().z();
+    // 找到交点后不断缩小光线的tmax
+    Ray rayTemp = ray;
+    rayTemp.setTMax(t);
+    traverseClosest(nodes.data(), root, rayTemp, [&](int offset, int count) {
+        traceTriangles(offset, count, rayTemp, t, slot, u, v);
+    });
 }
 
-// 光线与BVH截交计算
-void BVH::trace(const Ray &ray, float &t, Point &point) const
+// 光线与多叉BVH截交计算：每个节点用一次SIMD测试与所有子节点求交，
+// 相交的子节点按进入距离从远到近入栈，使最近的子节点最先被访问
+template <int N>
+void BVH::traceWide(const WideBVH<N> &wide, const Ray &ray, float &t, int &slot, float &u, float &v) const
 {
-    if (!aabb.trace(ray))
-        t = FLT_MAX;
-    else if (left != nullptr || right != nullptr)
+    Ray rayTemp = ray;
+    rayTemp.setTMax(t);
+    WideRay wideRay(ray);
+    // 栈中元素为子节点（或叶子）及其进入距离
+    struct Entry
     {
-        float tLeft, tRight;
-        Point pointLeft, pointRight;
-        left->trace(ray, tLeft, pointLeft);
-        right->trace(ray, tRight, pointRight);
-        if (tLeft < tRight)
+        int child, count;
+        float t;
+    };
+    TraversalStack<Entry, 256> stack;
+    stack.push({0, 0, ray.getTMin()});
+    while (!stack.empty())
+    {
+        Entry entry = stack.top();
+        stack.pop();
+        if (entry.t > t)
+            continue;
+        if (entry.count > 0)
         {
-            t = tLeft;
-            point = pointLeft;
+            traceTriangles(entry.child, entry.count, rayTemp, t, slot, u, v);
+            continue;
         }
-        else
+
+        const WideBVHNode<N> &node = wide.getNode(entry.child);
+        float tEntry[N];
+        int mask = WideBVH<N>::intersect(node, wideRay, t, tEntry);
+        // 将相交的子节点按进入距离从大到小插入栈顶
+        int base = stack.size();
+        for (int i = 0; i < N; i++)
         {
-            t = tRight;
-            point = pointRight;
+            if (!(mask & (1 << i)))
+                continue;
+            Entry child = {node.child[i], node.count[i], tEntry[i]};
+            int j = stack.size();
+            stack.push(child);
+            while (j > base && stack[j - 1].t < child.t)
+            {
+                stack[j] = stack[j - 1];
+                j--;
+            }
+            stack[j] = child;
         }
     }
-    else
+}
+
+static inline int countBits(uint64_t mask)
+{
+    int count = 0;
+    for (; mask; mask &= mask - 1)
+        count++;
+    return count;
+}
+
+// 光线包遍历：每个节点先用视锥剔除整个光线包，再逐条光线求交得到活跃光线，子节点按平均方向由近到远访问
+// 活跃光线少于PACKET_MIN_ACTIVE_RAYS时光线包已经发散，剩余光线从当前子树开始单独遍历
+uint64_t BVH::tracePacket(const RayPacket &packet, uint64_t mask, HitPacket &hit) const
+{
+    uint64_t updated = 0;
+    traversePacket(nodes.data(), packet, mask, hit.t, [&](int index, uint64_t active) {
+        if (countBits(active) < PACKET_MIN_ACTIVE_RAYS)
+        {
+            for (int i = 0; i < packet.getSize(); i++)
+            {
+                if (!((active >> i) & 1))
+                    continue;
+                int slot = -1;
+                traceBinary(packet.getRay(i), hit.t[i], slot, hit.u[i], hit.v[i], index);
+                if (slot >= 0)
+                {
+                    hit.primitive[i] = indices[slot];
+                    updated |= 1ULL << i;
+                }
+            }
+            return true;
+        }
+        const BVHNode &node = nodes[index];
+        if (node.count > 0)
+            updated |= tracePacketTriangles(node.offset, node.count, packet, active, hit);
+        return node.count > 0;
+    });
+    return updated;
+}
+
+// 与intersectRecord相同的计算，每次用SSE处理4条光线
+uint64_t BVH::tracePacketTriangles(int offset, int count, const RayPacket &packet, uint64_t mask, HitPacket &hit) const
+{
+    uint64_t updated = 0;
+    for (int g = 0; g < packet.getSize(); g += 4)
     {
-        t = FLT_MAX;
-        for (const Triangle &triangle : triangles)
+        int group = (int)((mask >> g) & 0xF);
+        if (group == 0)
+            continue;
+#if defined(__SSE__)
+        __m128 ox = _mm_load_ps(packet.getOrigin(0) + g), oy = _mm_load_ps(packet.getOrigin(1) + g), oz = _mm_load_ps(packet.getOrigin(2) + g);
+        __m128 dx = _mm_load_ps(packet.getDirection(0) + g), dy = _mm_load_ps(packet.getDirection(1) + g), dz = _mm_load_ps(packet.getDirection(2) + g);
+        __m128 tmin = _mm_load_ps(packet.getTMin() + g), epsilon = _mm_set1_ps(EPSILON), zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+        for (int i = offset; i < offset + count; i++)
         {
-            float tTemp;
-            Point pointTemp;
-            triangle.trace(ray, tTemp, pointTemp);
-            if (tTemp < t)
+            const TriangleRecord &record = records[i];
+            __m128 e1x = _mm_set1_ps(record.e1.x()), e1y = _mm_set1_ps(record.e1.y()), e1z = _mm_set1_ps(record.e1.z());
+            __m128 e2x = _mm_set1_ps(record.e2.x()), e2y = _mm_set1_ps(record.e2.y()), e2z = _mm_set1_ps(record.e2.z());
+            __m128 sx = _mm_sub_ps(ox, _mm_set1_ps(record.v0.x()));
+            __m128 sy = _mm_sub_ps(oy, _mm_set1_ps(record.v0.y()));
+            __m128 sz = _mm_sub_ps(oz, _mm_set1_ps(record.v0.z()));
+            // s1 = s x e1，s2 = d x e2
+            __m128 s1x = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+            __m128 s1y = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+            __m128 s1z = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+            __m128 s2x = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+            __m128 s2y = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+            __m128 s2z = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+            __m128 w = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, s2x), _mm_mul_ps(e1y, s2y)), _mm_mul_ps(e1z, s2z));
+            __m128 valid = _mm_cmpge_ps(w, epsilon);
+            if (!(_mm_movemask_ps(valid) & group))
+                continue;
+            __m128 t = _mm_div_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, s1x), _mm_mul_ps(e2y, s1y)), _mm_mul_ps(e2z, s1z)), w);
+            __m128 u = _mm_div_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, s2x), _mm_mul_ps(sy, s2y)), _mm_mul_ps(sz, s2z)), w);
+            __m128 v = _mm_div_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, s1x), _mm_mul_ps(dy, s1y)), _mm_mul_ps(dz, s1z)), w);
+            valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpgt_ps(t, tmin), _mm_cmplt_ps(t, _mm_loadu_ps(hit.t + g))));
+            valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmpge_ps(v, zero)));
+            valid = _mm_and_ps(valid, _mm_cmple_ps(_mm_add_ps(u, v), one));
+            int found = _mm_movemask_ps(valid) & group;
+            if (found == 0)
+                continue;
+            alignas(16) float tLanes[4], uLanes[4], vLanes[4];
+            _mm_store_ps(tLanes, t);
+            _mm_store_ps(uLanes, u);
+            _mm_store_ps(vLanes, v);
+            for (int k = 0; k < 4; k++)
+                if (found & (1 << k))
+                {
+                    hit.t[g + k] = tLanes[k];
+                    hit.u[g + k] = uLanes[k];
+                    hit.v[g + k] = vLanes[k];
+                    hit.primitive[g + k] = indices[i];
+                }
+            updated |= (uint64_t)found << g;
+        }
+#else
+        for (int k = 0; k < 4; k++)
+        {
+            if (!(group & (1 << k)))
+                continue;
+            Ray ray = packet.getRay(g + k);
+            ray.setTMax(hit.t[g + k]);
+            int slot = -1;
+            traceTriangles(offset, count, ray, hit.t[g + k], slot, hit.u[g + k], hit.v[g + k]);
+            if (slot >= 0)
             {
-                t = tTemp;
-                point = pointTemp;
+                hit.primitive[g + k] = indices[slot];
+                updated |= 1ULL << (g + k);
             }
         }
+#endif
+    }
+    return updated;
+}
+
+bool BVH::occluded(const Ray &ray) const
+{
+    if (!bvh4.empty())
+        return occludedWide(bvh4, ray);
+    else if (!bvh8.empty())
+        return occludedWide(bvh8, ray);
+    else
+        return occludedBinary(ray);
+}
+
+bool BVH::occludedTriangles(int offset, int count, const Ray &ray) const
+{
+    QVector3D o = ray.getOrigin();
+    QVector3D d = ray.getDirection();
+    float t, u, v;
+    for (int i = offset; i < offset + count; i++)
+        if (intersectRecord(records[i], o, d, ray, t, u, v))
+            return true;
+    return false;
+}
+
+// 任意交点查询不需要按距离排序，找到交点立即返回
+bool BVH::occludedBinary(const Ray &ray) const
+{
+    return traverseAny(nodes.data(), ray, [&](int offset, int count) {
+        return occludedTriangles(offset, count, ray);
+    });
+}
+
+template <int N>
+bool BVH::occludedWide(const WideBVH<N> &wide, const Ray &ray) const
+{
+    WideRay wideRay(ray);
+    struct Entry
+    {
+        int child, count;
+    };
+    TraversalStack<Entry, 256> stack;
+    stack.push({0, 0});
+    while (!stack.empty())
+    {
+        Entry entry = stack.top();
+        stack.pop();
+        if (entry.count > 0)
+        {
+            if (occludedTriangles(entry.child, entry.count, ray))
+                return true;
+            continue;
+        }
+        const WideBVHNode<N> &node = wide.getNode(entry.child);
+        float tEntry[N];
+        int mask = WideBVH<N>::intersect(node, wideRay, ray.getTMax(), tEntry);
+        for (int i = 0; i < N; i++)
+            if (mask & (1 << i))
+                stack.push({node.child[i], node.count[i]});
     }
+    return false;
 }
\ No newline at end of file
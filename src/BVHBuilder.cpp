@@ -0,0 +1,1031 @@
+#include "BVHBuilder.h"
+
+#include <omp.h>
+
+// 每个轴上各个桶的aabb与图元数量
+struct SAHBins
+{
+    AABB aabb[3][BVH_SAH_BINS];
+    int count[3][BVH_SAH_BINS];
+
+    SAHBins()
+    {
+        std::fill(&count[0][0], &count[0][0] + 3 * BVH_SAH_BINS, 0);
+    }
+
+    void combine(const SAHBins &bins)
+    {
+        for (int a = 0; a < 3; a++)
+            for (int b = 0; b < BVH_SAH_BINS; b++)
+            {
+                aabb[a][b].combine(bins.aabb[a][b]);
+                count[a][b] += bins.count[a][b];
+            }
+    }
+};
+
+// LBVH的中间结构，子节点显式存储，便于treelet优化后再展开为深度优先顺序
+struct LBVHTree
+{
+    std::vector<AABB> aabb;
+    // 内部节点的左右子节点，叶节点为-1
+    std::vector<int> left, right;
+    // 叶节点的图元区间
+    std::vector<int> offset, count;
+    // 子树中的图元数量与SAH代价（未除以根节点面积）
+    std::vector<int> size;
+    std::vector<float> cost;
+    // 已分配的节点数
+    int nodes;
+
+    LBVHTree(int capacity) : aabb(capacity), left(capacity, -1), right(capacity, -1), offset(capacity, 0), count(capacity, 0), size(capacity, 0), cost(capacity, 0.0f), nodes(0) {}
+
+    int allocate()
+    {
+        int id;
+#pragma omp atomic capture
+        id = nodes++;
+        return id;
+    }
+};
+
+// SBVH中的图元引用：空间划分会把一个三角形分到多个子树中，每个引用的aabb只包络三角形落在对应区域内的部分
+struct SBVHReference
+{
+    int index;
+    AABB aabb;
+};
+
+// 空间划分在一个轴上的桶：裁剪到桶内的aabb，以及从该桶开始、在该桶结束的引用数量
+struct SpatialBins
+{
+    AABB aabb[BVH_SBVH_BINS];
+    int entries[BVH_SBVH_BINS], exits[BVH_SBVH_BINS];
+
+    SpatialBins()
+    {
+        std::fill(entries, entries + BVH_SBVH_BINS, 0);
+        std::fill(exits, exits + BVH_SBVH_BINS, 0);
+    }
+};
+
+// 扫描桶边界，entries/exits为每个桶左侧、右侧计数时使用的图元数量（物体划分时两者相同）
+// 返回代价N_l*SA_l+N_r*SA_r最小且两侧都非空的划分位置（在桶split之前划分），没有时返回-1
+template <int BINS>
+static int sweepBins(const AABB *aabb, const int *entries, const int *exits, float &bestCost)
+{
+    // 从右向左扫描，得到每个划分位置右侧的面积与数量
+    float rightAreas[BINS];
+    int rightCounts[BINS];
+    AABB rightBox;
+    int rightCount = 0;
+    for (int i = BINS - 1; i > 0; i--)
+    {
+        rightBox.combine(aabb[i]);
+        rightCount += exits[i];
+        rightAreas[i] = rightBox.surfaceArea();
+        rightCounts[i] = rightCount;
+    }
+    // 从左向右扫描，在桶i之前划分
+    AABB leftBox;
+    int leftCount = 0, best = -1;
+    bestCost = FLT_MAX;
+    for (int i = 1; i < BINS; i++)
+    {
+        leftBox.combine(aabb[i - 1]);
+        leftCount += entries[i - 1];
+        if (leftCount == 0 || rightCounts[i] == 0)
+            continue;
+        float cost = leftCount * leftBox.surfaceArea() + rightCounts[i] * rightAreas[i];
+        if (cost < bestCost)
+        {
+            bestCost = cost;
+            best = i;
+        }
+    }
+    return best;
+}
+
+BVHBuilder::BVHBuilder(const std::vector<AABB> &bounds, const std::vector<QVector3D> &centers, BVHBuildMethod method) : bounds(bounds),
+                                                                                                                       centers(centers),
+                                                                                                                       method(method),
+                                                                                                                       indices(nullptr),
+                                                                                                                       vertices(nullptr),
+                                                                                                                       sbvhReferences(0),
+                                                                                                                       sbvhLimit(0),
+                                                                                                                       rootArea(0.0f) {}
+
+BVHBuilder::~BVHBuilder() {}
+
+void BVHBuilder::setTriangles(const std::vector<QVector3D> &vertices)
+{
+    this->vertices = &vertices;
+}
+
+void BVHBuilder::build(std::vector<BVHNode> &nodes, std::vector<int> &indices)
+{
+    this->indices = &indices;
+    indices.resize(bounds.size());
+    for (int i = 0; i < (int)indices.size(); i++)
+        indices[i] = i;
+    // 二叉树的节点数不超过2n-1
+    nodes.clear();
+    nodes.reserve(std::max<size_t>(1, 2 * bounds.size()));
+    if (method == BVH_BUILD_LBVH && !bounds.empty())
+    {
+        buildLBVH(nodes);
+        return;
+    }
+    // SBVH需要三角形顶点，顶层BVH等没有顶点的情况按SAH构建
+    if (method == BVH_BUILD_SBVH && vertices != nullptr && !bounds.empty())
+    {
+        std::vector<SBVHReference> references(bounds.size());
+        AABB aabb;
+        for (int i = 0; i < (int)references.size(); i++)
+        {
+            references[i].index = i;
+            references[i].aabb = bounds[i];
+            aabb.combine(bounds[i]);
+        }
+        sbvhReferences = (int)references.size();
+        sbvhLimit = (int)(references.size() * (1.0f + BVH_SBVH_BUDGET));
+        rootArea = aabb.surfaceArea();
+        indices.clear();
+        if (references.size() >= BVH_PARALLEL_THRESHOLD)
+        {
+#pragma omp parallel
+#pragma omp single
+            buildSBVH(nodes, indices, references);
+        }
+        else
+            buildSBVH(nodes, indices, references);
+        return;
+    }
+    // 图元较多时由一个线程发起构建，大的子树作为OpenMP任务交给其他线程
+    if (bounds.size() >= BVH_PARALLEL_THRESHOLD)
+    {
+#pragma omp parallel
+#pragma omp single
+        build(nodes, 0, (int)indices.size());
+    }
+    else
+        build(nodes, 0, (int)indices.size());
+}
+
+// BVH的递归构建过程
+// Top-down模式，节点按深度优先顺序直接写入节点数组
+int BVHBuilder::build(std::vector<BVHNode> &nodes, int begin, int end)
+{
+    int index = (int)nodes.size();
+    nodes.push_back(BVHNode());
+
+    // 当前节点的aabb位包络所有子节点的aabb
+    AABB aabb, centerBox;
+    computeBounds(begin, end, aabb, centerBox);
+
+    int count = end - begin, axis = 0, middle = -1;
+    if (method == BVH_BUILD_MEDIAN)
+    {
+        //小于BVH节点图元分裂下限就不再进行分裂
+        if (count > BVH_LIMIT)
+            middle = splitMedian(aabb, begin, end, axis);
+    }
+    else if (count > 1)
+        // 由SAH代价决定是否继续分裂（没有三角形顶点的SBVH也按SAH处理）
+        middle = splitSAH(aabb, centerBox, begin, end, axis);
+
+    nodes[index].aabb = aabb;
+    nodes[index].axis = (uint8_t)axis;
+    if (middle < 0)
+    {
+        nodes[index].offset = begin;
+        nodes[index].count = (uint16_t)count;
+    }
+    else if (count >= BVH_PARALLEL_THRESHOLD)
+    {
+        // 左右子树的图元索引区间互不重叠，可以作为独立任务并行构建到各自的节点数组中
+        std::vector<BVHNode> leftNodes, rightNodes;
+#pragma omp task shared(leftNodes)
+        build(leftNodes, begin, middle);
+#pragma omp task shared(rightNodes)
+        build(rightNodes, middle, end);
+#pragma omp taskwait
+        // 拼接到当前节点之后，内部节点的子节点下标需要加上偏移
+        append(nodes, leftNodes);
+        int right = append(nodes, rightNodes);
+        nodes[index].offset = right;
+        nodes[index].count = 0;
+    }
+    else
+    {
+        // 左子树紧随当前节点之后
+        build(nodes, begin, middle);
+        int right = build(nodes, middle, end);
+        nodes[index].offset = right;
+        nodes[index].count = 0;
+    }
+    return index;
+}
+
+int BVHBuilder::append(std::vector<BVHNode> &nodes, const std::vector<BVHNode> &subtree, int indexOffset)
+{
+    int base = (int)nodes.size();
+    for (BVHNode node : subtree)
+    {
+        if (node.count == 0)
+            node.offset += base;
+        else
+            node.offset += indexOffset;
+        nodes.push_back(node);
+    }
+    return base;
+}
+
+void BVHBuilder::computeBounds(int begin, int end, AABB &aabb, AABB &centerBox) const
+{
+    int chunks = (end - begin + BVH_PARALLEL_CHUNK - 1) / BVH_PARALLEL_CHUNK;
+    if (chunks <= 1)
+    {
+        for (int i = begin; i < end; i++)
+        {
+            aabb.combine(bounds[(*indices)[i]]);
+            centerBox.add(centers[(*indices)[i]]);
+        }
+        return;
+    }
+    // 图元较多时分块并行计算，再合并各块的结果
+    std::vector<AABB> aabbs(chunks), centerBoxes(chunks);
+    for (int c = 0; c < chunks; c++)
+    {
+#pragma omp task shared(aabbs, centerBoxes) firstprivate(c)
+        {
+            int chunkEnd = std::min(end, begin + (c + 1) * BVH_PARALLEL_CHUNK);
+            for (int i = begin + c * BVH_PARALLEL_CHUNK; i < chunkEnd; i++)
+            {
+                aabbs[c].combine(bounds[(*indices)[i]]);
+                centerBoxes[c].add(centers[(*indices)[i]]);
+            }
+        }
+    }
+#pragma omp taskwait
+    for (int c = 0; c < chunks; c++)
+    {
+        aabb.combine(aabbs[c]);
+        centerBox.combine(centerBoxes[c]);
+    }
+}
+
+int BVHBuilder::splitMedian(const AABB &aabb, int begin, int end, int &axis)
+{
+    // 选择最大轴物体数量中点进行划分
+    float x = aabb.rangeX(), y = aabb.rangeY(), z = aabb.rangeZ();
+    axis = x >= y && x >= z ? 0 : (y >= z ? 1 : 2);
+    int middle = begin + (end - begin) / 2;
+    std::nth_element(indices->begin() + begin, indices->begin() + middle, indices->begin() + end, [&](int i0, int i1)
+                     { return centers[i0][axis] < centers[i1][axis]; });
+    return middle;
+}
+
+// 分箱SAH：将图元按重心落入每个轴上等宽的桶中，只在桶边界处评估划分代价
+// cost = C_trav + C_isect * (N_l * SA_l + N_r * SA_r) / SA
+int BVHBuilder::splitSAH(const AABB &aabb, const AABB &centerBox, int begin, int end, int &axis)
+{
+    // 重心的包围盒决定分箱范围
+    QVector3D low = centerBox.getMin(), extent = centerBox.getMax() - centerBox.getMin();
+    QVector3D scale;
+    for (int a = 0; a < 3; a++)
+        scale[a] = extent[a] < EPSILON ? 0.0f : BVH_SAH_BINS / extent[a];
+
+    // 一次遍历同时完成三个轴的分箱，图元较多时分块并行
+    SAHBins bins;
+    int chunks = (end - begin + BVH_PARALLEL_CHUNK - 1) / BVH_PARALLEL_CHUNK;
+    if (chunks <= 1)
+        binPrimitives(begin, end, low, scale, bins);
+    else
+    {
+        std::vector<SAHBins> partial(chunks);
+        for (int c = 0; c < chunks; c++)
+        {
+#pragma omp task shared(partial, low, scale) firstprivate(c)
+            binPrimitives(begin + c * BVH_PARALLEL_CHUNK, std::min(end, begin + (c + 1) * BVH_PARALLEL_CHUNK), low, scale, partial[c]);
+        }
+#pragma omp taskwait
+        for (int c = 0; c < chunks; c++)
+            bins.combine(partial[c]);
+    }
+
+    float area = aabb.surfaceArea();
+    float bestCost = FLT_MAX;
+    int bestAxis = -1, bestSplit = 0;
+    for (int a = 0; a < 3; a++)
+    {
+        // 所有重心在该轴上重合，无法划分
+        if (extent[a] < EPSILON)
+            continue;
+
+        float cost;
+        int split = sweepBins<BVH_SAH_BINS>(bins.aabb[a], bins.count[a], bins.count[a], cost);
+        if (split < 0)
+            continue;
+        cost = BVH_TRAVERSAL_COST + BVH_INTERSECTION_COST * cost / area;
+        if (cost < bestCost)
+        {
+            bestCost = cost;
+            bestAxis = a;
+            bestSplit = split;
+        }
+    }
+
+    // 不划分时的代价为逐个求交所有图元
+    int count = end - begin;
+    float leafCost = BVH_INTERSECTION_COST * count;
+    if (bestAxis < 0 || bestCost >= leafCost)
+    {
+        if (count <= BVH_MAX_LEAF_SIZE)
+            return -1;
+        // 图元过多但找不到有效划分（如重心重合），退化为中位数划分
+        if (bestAxis < 0)
+            return splitMedian(aabb, begin, end, axis);
+    }
+
+    axis = bestAxis;
+    auto middle = std::partition(indices->begin() + begin, indices->begin() + end, [&](int i)
+                                 { return std::min((int)((centers[i][bestAxis] - low[bestAxis]) * scale[bestAxis]), BVH_SAH_BINS - 1) < bestSplit; });
+    return (int)(middle - indices->begin());
+}
+
+void BVHBuilder::binPrimitives(int begin, int end, const QVector3D &low, const QVector3D &scale, SAHBins &bins) const
+{
+    for (int i = begin; i < end; i++)
+    {
+        int index = (*indices)[i];
+        for (int a = 0; a < 3; a++)
+        {
+            int b = std::min((int)((centers[index][a] - low[a]) * scale[a]), BVH_SAH_BINS - 1);
+            bins.count[a][b]++;
+            bins.aabb[a][b].combine(bounds[index]);
+        }
+    }
+}
+
+// 将10位整数的每一位之间插入两个0，用于30位Morton码
+static uint64_t expandBits10(uint64_t v)
+{
+    v = (v * 0x00010001u) & 0xFF0000FFu;
+    v = (v * 0x00000101u) & 0x0F00F00Fu;
+    v = (v * 0x00000011u) & 0xC30C30C3u;
+    v = (v * 0x00000005u) & 0x49249249u;
+    return v;
+}
+
+// 将21位整数的每一位之间插入两个0，用于63位Morton码
+static uint64_t expandBits21(uint64_t v)
+{
+    v &= 0x1fffff;
+    v = (v | v << 32) & 0x1f00000000ffffull;
+    v = (v | v << 16) & 0x1f0000ff0000ffull;
+    v = (v | v << 8) & 0x100f00f00f00f00full;
+    v = (v | v << 4) & 0x10c30c30c30c30c3ull;
+    v = (v | v << 2) & 0x1249249249249249ull;
+    return v;
+}
+
+// 并行LSD基数排序，每轮处理8位，各线程先统计本块的直方图，再按(位值, 块)的顺序计算写入位置
+static void radixSort(std::vector<uint64_t> &keys, std::vector<int> &values, int bits)
+{
+    int n = (int)keys.size();
+    std::vector<uint64_t> keysTemp(n);
+    std::vector<int> valuesTemp(n);
+    int chunks = std::max(1, std::min(omp_get_max_threads(), n / BVH_PARALLEL_CHUNK));
+    int chunkSize = (n + chunks - 1) / chunks;
+    std::vector<std::vector<int>> histograms(chunks, std::vector<int>(256));
+    for (int shift = 0; shift < bits; shift += 8)
+    {
+#pragma omp parallel for
+        for (int c = 0; c < chunks; c++)
+        {
+            std::vector<int> &histogram = histograms[c];
+            std::fill(histogram.begin(), histogram.end(), 0);
+            for (int i = c * chunkSize; i < std::min(n, (c + 1) * chunkSize); i++)
+                histogram[(keys[i] >> shift) & 255]++;
+        }
+        int sum = 0;
+        for (int d = 0; d < 256; d++)
+            for (int c = 0; c < chunks; c++)
+            {
+                int temp = histograms[c][d];
+                histograms[c][d] = sum;
+                sum += temp;
+            }
+#pragma omp parallel for
+        for (int c = 0; c < chunks; c++)
+        {
+            std::vector<int> &histogram = histograms[c];
+            for (int i = c * chunkSize; i < std::min(n, (c + 1) * chunkSize); i++)
+            {
+                int position = histogram[(keys[i] >> shift) & 255]++;
+                keysTemp[position] = keys[i];
+                valuesTemp[position] = values[i];
+            }
+        }
+        keys.swap(keysTemp);
+        values.swap(valuesTemp);
+    }
+}
+
+// 后序遍历时调用：以root为根展开最多7个叶子的treelet，
+// 对叶子的所有子集用动态规划求SAH代价最小的拓扑，代价更低时就地重建treelet的内部节点
+static void restructureTreelet(LBVHTree &tree, int root)
+{
+    const int MAX_LEAVES = 7;
+    int leaves[MAX_LEAVES], internals[MAX_LEAVES];
+    int n = 2, m = 0;
+    leaves[0] = tree.left[root];
+    leaves[1] = tree.right[root];
+    // 反复展开面积最大的内部节点
+    while (n < MAX_LEAVES)
+    {
+        int best = -1;
+        float bestArea = -1.0f;
+        for (int i = 0; i < n; i++)
+            if (tree.left[leaves[i]] >= 0 && tree.aabb[leaves[i]].surfaceArea() > bestArea)
+            {
+                best = i;
+                bestArea = tree.aabb[leaves[i]].surfaceArea();
+            }
+        if (best < 0)
+            break;
+        int node = leaves[best];
+        internals[m++] = node;
+        leaves[best] = tree.left[node];
+        leaves[n++] = tree.right[node];
+    }
+    if (n < 3)
+        return;
+
+    // 子集S的包围盒、最优代价以及最优划分中包含S最低位的一侧
+    int full = (1 << n) - 1;
+    AABB boxes[1 << MAX_LEAVES];
+    float costs[1 << MAX_LEAVES];
+    int parts[1 << MAX_LEAVES];
+    int sizes[1 << MAX_LEAVES];
+    for (int S = 1; S <= full; S++)
+    {
+        int low = S & -S;
+        if (S == low)
+        {
+            int leaf = leaves[__builtin_ctz(S)];
+            boxes[S] = tree.aabb[leaf];
+            costs[S] = tree.cost[leaf];
+            sizes[S] = tree.size[leaf];
+            continue;
+        }
+        boxes[S] = boxes[S ^ low];
+        boxes[S].combine(boxes[low]);
+        sizes[S] = sizes[S ^ low] + sizes[low];
+        float best = FLT_MAX;
+        // 只枚举包含最低位的真子集，避免对称的重复划分
+        for (int P = (S - 1) & S; P > 0; P = (P - 1) & S)
+        {
+            if (!(P & low))
+                continue;
+            float cost = costs[P] + costs[S ^ P];
+            if (cost < best)
+            {
+                best = cost;
+                parts[S] = P;
+            }
+        }
+        costs[S] = BVH_TRAVERSAL_COST * boxes[S].surfaceArea() + best;
+    }
+    if (costs[full] >= tree.cost[root] * (1.0f - 1e-5f))
+        return;
+
+    // 自顶向下重建，复用treelet原有的内部节点编号
+    int subsets[MAX_LEAVES], ids[MAX_LEAVES];
+    int top = 0, next = 0;
+    subsets[top] = full;
+    ids[top++] = root;
+    while (top > 0)
+    {
+        int S = subsets[--top], id = ids[top];
+        tree.aabb[id] = boxes[S];
+        tree.cost[id] = costs[S];
+        tree.size[id] = sizes[S];
+        int children[2] = {parts[S], S ^ parts[S]};
+        int childIds[2];
+        for (int k = 0; k < 2; k++)
+        {
+            int C = children[k];
+            if (C == (C & -C))
+                childIds[k] = leaves[__builtin_ctz(C)];
+            else
+            {
+                childIds[k] = internals[next++];
+                subsets[top] = C;
+                ids[top++] = childIds[k];
+            }
+        }
+        tree.left[id] = childIds[0];
+        tree.right[id] = childIds[1];
+    }
+}
+
+// 后序遍历整棵树进行treelet优化，大的子树作为独立任务并行处理
+static void refineTreelets(LBVHTree &tree, int node)
+{
+    if (tree.left[node] < 0 || tree.size[node] < BVH_LBVH_TREELET_MIN_SIZE)
+        return;
+    if (tree.size[node] >= BVH_PARALLEL_THRESHOLD)
+    {
+#pragma omp task shared(tree)
+        refineTreelets(tree, tree.left[node]);
+#pragma omp task shared(tree)
+        refineTreelets(tree, tree.right[node]);
+#pragma omp taskwait
+    }
+    else
+    {
+        refineTreelets(tree, tree.left[node]);
+        refineTreelets(tree, tree.right[node]);
+    }
+    restructureTreelet(tree, node);
+}
+
+// 将显式子节点的树展开为深度优先顺序的节点数组
+static int flattenLBVH(const LBVHTree &tree, int node, std::vector<BVHNode> &nodes)
+{
+    int index = (int)nodes.size();
+    nodes.push_back(BVHNode());
+    const AABB &aabb = tree.aabb[node];
+    nodes[index].aabb = aabb;
+    if (tree.left[node] < 0)
+    {
+        nodes[index].offset = tree.offset[node];
+        nodes[index].count = (uint16_t)tree.count[node];
+        nodes[index].axis = 0;
+    }
+    else
+    {
+        float x = aabb.rangeX(), y = aabb.rangeY(), z = aabb.rangeZ();
+        nodes[index].axis = x >= y && x >= z ? 0 : (y >= z ? 1 : 2);
+        flattenLBVH(tree, tree.left[node], nodes);
+        int right = flattenLBVH(tree, tree.right[node], nodes);
+        nodes[index].offset = right;
+        nodes[index].count = 0;
+    }
+    return index;
+}
+
+void BVHBuilder::buildLBVH(std::vector<BVHNode> &nodes)
+{
+    int n = (int)bounds.size();
+    bool parallel = n >= BVH_PARALLEL_THRESHOLD;
+
+    // 重心的包围盒，分块并行计算
+    int chunks = (n + BVH_PARALLEL_CHUNK - 1) / BVH_PARALLEL_CHUNK;
+    std::vector<AABB> centerBoxes(chunks);
+#pragma omp parallel for if (parallel)
+    for (int c = 0; c < chunks; c++)
+        for (int i = c * BVH_PARALLEL_CHUNK; i < std::min(n, (c + 1) * BVH_PARALLEL_CHUNK); i++)
+            centerBoxes[c].add(centers[i]);
+    AABB centerBox;
+    for (const AABB &box : centerBoxes)
+        centerBox.combine(box);
+    QVector3D low = centerBox.getMin(), extent = centerBox.getMax() - centerBox.getMin();
+
+    // 将重心量化到每个轴10位（30位码）或21位（63位码）后交错得到Morton码
+    int axisBits = BVH_LBVH_MORTON_BITS > 30 ? 21 : 10;
+    float scale = (float)((1 << axisBits) - 1);
+    std::vector<uint64_t> codes(n);
+#pragma omp parallel for if (parallel)
+    for (int i = 0; i < n; i++)
+    {
+        uint64_t q[3];
+        for (int a = 0; a < 3; a++)
+        {
+            float x = extent[a] < EPSILON ? 0.0f : (centers[i][a] - low[a]) / extent[a];
+            q[a] = (uint64_t)std::min(std::max(x * scale, 0.0f), scale);
+        }
+        codes[i] = axisBits == 21 ? (expandBits21(q[0]) << 2) | (expandBits21(q[1]) << 1) | expandBits21(q[2])
+                                  : (expandBits10(q[0]) << 2) | (expandBits10(q[1]) << 1) | expandBits10(q[2]);
+    }
+    radixSort(codes, *indices, 3 * axisBits);
+
+    // 节点数不超过2n-1
+    LBVHTree tree(2 * n);
+    int root;
+    if (parallel)
+    {
+#pragma omp parallel
+#pragma omp single
+        {
+            root = emitLBVH(tree, codes, 0, n);
+            for (int pass = 0; pass < BVH_LBVH_TREELET_PASSES; pass++)
+                refineTreelets(tree, root);
+        }
+    }
+    else
+    {
+        root = emitLBVH(tree, codes, 0, n);
+        for (int pass = 0; pass < BVH_LBVH_TREELET_PASSES; pass++)
+            refineTreelets(tree, root);
+    }
+    flattenLBVH(tree, root, nodes);
+}
+
+int BVHBuilder::emitLBVH(LBVHTree &tree, const std::vector<uint64_t> &codes, int begin, int end) const
+{
+    int id = tree.allocate();
+    int count = end - begin;
+    tree.size[id] = count;
+    if (count <= BVH_LBVH_LEAF_SIZE)
+    {
+        AABB aabb;
+        for (int i = begin; i < end; i++)
+            aabb.combine(bounds[(*indices)[i]]);
+        tree.aabb[id] = aabb;
+        tree.offset[id] = begin;
+        tree.count[id] = count;
+        tree.cost[id] = BVH_INTERSECTION_COST * count * aabb.surfaceArea();
+        return id;
+    }
+
+    // 在Morton码最高的不同位处划分，码全部相同时取中点
+    int split;
+    uint64_t first = codes[begin], last = codes[end - 1];
+    if (first == last)
+        split = begin + count / 2;
+    else
+    {
+        uint64_t bit = 1ull << (63 - __builtin_clzll(first ^ last));
+        // 区间内更高位都相同，该位为0的码全部排在为1的码之前
+        int lo = begin, hi = end - 1;
+        while (lo < hi)
+        {
+            int middle = (lo + hi) / 2;
+            if (codes[middle] & bit)
+                hi = middle;
+            else
+                lo = middle + 1;
+        }
+        split = lo;
+    }
+
+    int left, right;
+    if (count >= BVH_PARALLEL_THRESHOLD)
+    {
+#pragma omp task shared(tree, codes, left)
+        left = emitLBVH(tree, codes, begin, split);
+#pragma omp task shared(tree, codes, right)
+        right = emitLBVH(tree, codes, split, end);
+#pragma omp taskwait
+    }
+    else
+    {
+        left = emitLBVH(tree, codes, begin, split);
+        right = emitLBVH(tree, codes, split, end);
+    }
+    tree.left[id] = left;
+    tree.right[id] = right;
+    tree.aabb[id] = tree.aabb[left];
+    tree.aabb[id].combine(tree.aabb[right]);
+    tree.cost[id] = BVH_TRAVERSAL_COST * tree.aabb[id].surfaceArea() + tree.cost[left] + tree.cost[right];
+    return id;
+}
+static QVector3D minVector(const QVector3D &a, const QVector3D &b)
+{
+    return QVector3D(std::min(a.x(), b.x()), std::min(a.y(), b.y()), std::min(a.z(), b.z()));
+}
+
+static QVector3D maxVector(const QVector3D &a, const QVector3D &b)
+{
+    return QVector3D(std::max(a.x(), b.x()), std::max(a.y(), b.y()), std::max(a.z(), b.z()));
+}
+
+// SBVH（Stich et al. 2009）：每个节点同时评估物体划分与空间划分，
+// 空间划分把跨越划分平面的三角形裁剪到两侧，减少细长三角形造成的子节点重叠
+int BVHBuilder::buildSBVH(std::vector<BVHNode> &nodes, std::vector<int> &leafIndices, std::vector<SBVHReference> &references)
+{
+    int index = (int)nodes.size();
+    nodes.push_back(BVHNode());
+
+    AABB aabb, centerBox;
+    for (const SBVHReference &reference : references)
+    {
+        aabb.combine(reference.aabb);
+        centerBox.add(reference.aabb.getCenter());
+    }
+    int count = (int)references.size();
+    float area = aabb.surfaceArea();
+
+    // 物体划分两侧的重叠较大且还有引用预算时才尝试空间划分
+    int objectAxis = -1, objectSplit = 0, spatialAxis = -1;
+    float spatialPosition = 0.0f, objectCost = FLT_MAX, spatialCost = FLT_MAX;
+    AABB leftBox, rightBox;
+    if (count > 1)
+        objectCost = splitObject(references, centerBox, objectAxis, objectSplit, leftBox, rightBox);
+    int budget;
+#pragma omp atomic read
+    budget = sbvhReferences;
+    if (count > 1 && budget < sbvhLimit)
+    {
+        AABB overlap = leftBox;
+        overlap.intersect(rightBox);
+        if (objectAxis < 0 || overlap.surfaceArea() > BVH_SBVH_ALPHA * rootArea)
+            spatialCost = splitSpatial(references, aabb, spatialAxis, spatialPosition);
+    }
+    float bestCost = std::min(objectCost, spatialCost);
+    bestCost = area > 0.0f && bestCost < FLT_MAX ? BVH_TRAVERSAL_COST + BVH_INTERSECTION_COST * bestCost / area : FLT_MAX;
+    bool leaf = count == 1 || (bestCost >= BVH_INTERSECTION_COST * count && count <= BVH_MAX_LEAF_SIZE);
+
+    std::vector<SBVHReference> left, right;
+    int axis = 0;
+    if (!leaf && spatialCost < objectCost)
+    {
+        axis = spatialAxis;
+        int duplicates = partitionSpatial(references, axis, spatialPosition, left, right);
+        // 引用全部被分到一侧时没有进展，改用物体划分
+        if ((int)left.size() == count || (int)right.size() == count || left.empty() || right.empty())
+        {
+            left.clear();
+            right.clear();
+        }
+        else
+        {
+#pragma omp atomic
+            sbvhReferences += duplicates;
+        }
+    }
+    if (!leaf && left.empty())
+    {
+        if (objectAxis >= 0)
+        {
+            axis = objectAxis;
+            float low = centerBox.getMin()[axis], scale = BVH_SAH_BINS / (centerBox.getMax()[axis] - low);
+            for (const SBVHReference &reference : references)
+            {
+                int b = std::min((int)((reference.aabb.getCenter()[axis] - low) * scale), BVH_SAH_BINS - 1);
+                (b < objectSplit ? left : right).push_back(reference);
+            }
+        }
+        else
+        {
+            // 重心重合无法按SAH划分，退化为中位数划分
+            float x = aabb.rangeX(), y = aabb.rangeY(), z = aabb.rangeZ();
+            axis = x >= y && x >= z ? 0 : (y >= z ? 1 : 2);
+            std::nth_element(references.begin(), references.begin() + count / 2, references.end(), [&](const SBVHReference &r0, const SBVHReference &r1)
+                             { return r0.aabb.getCenter()[axis] < r1.aabb.getCenter()[axis]; });
+            left.assign(references.begin(), references.begin() + count / 2);
+            right.assign(references.begin() + count / 2, references.end());
+        }
+    }
+
+    nodes[index].aabb = aabb;
+    nodes[index].axis = (uint8_t)axis;
+    if (leaf)
+    {
+        nodes[index].offset = (int)leafIndices.size();
+        nodes[index].count = (uint16_t)count;
+        for (const SBVHReference &reference : references)
+            leafIndices.push_back(reference.index);
+        return index;
+    }
+
+    // 子节点的引用已经复制出来，释放当前节点的引用
+    std::vector<SBVHReference>().swap(references);
+    nodes[index].count = 0;
+    if (count >= BVH_PARALLEL_THRESHOLD)
+    {
+        // 两侧的引用互相独立，各自构建到自己的节点与索引数组中再拼接
+        std::vector<BVHNode> leftNodes, rightNodes;
+        std::vector<int> leftIndices, rightIndices;
+#pragma omp task shared(leftNodes, leftIndices, left)
+        buildSBVH(leftNodes, leftIndices, left);
+#pragma omp task shared(rightNodes, rightIndices, right)
+        buildSBVH(rightNodes, rightIndices, right);
+#pragma omp taskwait
+        append(nodes, leftNodes, (int)leafIndices.size());
+        leafIndices.insert(leafIndices.end(), leftIndices.begin(), leftIndices.end());
+        int rightNode = append(nodes, rightNodes, (int)leafIndices.size());
+        leafIndices.insert(leafIndices.end(), rightIndices.begin(), rightIndices.end());
+        nodes[index].offset = rightNode;
+    }
+    else
+    {
+        buildSBVH(nodes, leafIndices, left);
+        int rightNode = buildSBVH(nodes, leafIndices, right);
+        nodes[index].offset = rightNode;
+    }
+    return index;
+}
+
+float BVHBuilder::splitObject(const std::vector<SBVHReference> &references, const AABB &centerBox, int &axis, int &split, AABB &leftBox, AABB &rightBox) const
+{
+    QVector3D low = centerBox.getMin(), extent = centerBox.getMax() - centerBox.getMin();
+    SAHBins bins;
+    for (const SBVHReference &reference : references)
+    {
+        QVector3D center = reference.aabb.getCenter();
+        for (int a = 0; a < 3; a++)
+        {
+            int b = extent[a] < EPSILON ? 0 : std::min((int)((center[a] - low[a]) * (BVH_SAH_BINS / extent[a])), BVH_SAH_BINS - 1);
+            bins.count[a][b]++;
+            bins.aabb[a][b].combine(reference.aabb);
+        }
+    }
+
+    float bestCost = FLT_MAX;
+    axis = -1;
+    for (int a = 0; a < 3; a++)
+    {
+        if (extent[a] < EPSILON)
+            continue;
+        float cost;
+        int b = sweepBins<BVH_SAH_BINS>(bins.aabb[a], bins.count[a], bins.count[a], cost);
+        if (b >= 0 && cost < bestCost)
+        {
+            bestCost = cost;
+            axis = a;
+            split = b;
+        }
+    }
+    // 两侧的包围盒用于估计重叠面积
+    if (axis >= 0)
+    {
+        leftBox = AABB();
+        rightBox = AABB();
+        for (int b = 0; b < BVH_SAH_BINS; b++)
+            (b < split ? leftBox : rightBox).combine(bins.aabb[axis][b]);
+    }
+    return bestCost;
+}
+
+float BVHBuilder::splitSpatial(const std::vector<SBVHReference> &references, const AABB &aabb, int &axis, float &position) const
+{
+    QVector3D low = aabb.getMin(), extent = aabb.getMax() - aabb.getMin();
+    // 三个轴的分桶与裁剪互相独立，引用较多时作为并行任务
+    float costs[3] = {FLT_MAX, FLT_MAX, FLT_MAX}, positions[3];
+    auto binAxis = [&](int a)
+    {
+        float width = extent[a] / BVH_SBVH_BINS, scale = BVH_SBVH_BINS / extent[a];
+        SpatialBins bins;
+        for (const SBVHReference &reference : references)
+        {
+            int first = std::min(std::max((int)((reference.aabb.getMin()[a] - low[a]) * scale), 0), BVH_SBVH_BINS - 1);
+            int last = std::min(std::max((int)((reference.aabb.getMax()[a] - low[a]) * scale), first), BVH_SBVH_BINS - 1);
+            // 沿轴依次在桶边界处裁剪，左侧部分放入当前桶，右侧部分继续裁剪
+            AABB rest = reference.aabb;
+            for (int b = first; b < last; b++)
+            {
+                AABB leftPart, rightPart;
+                splitReference(reference.index, rest, a, low[a] + (b + 1) * width, leftPart, rightPart);
+                bins.aabb[b].combine(leftPart);
+                rest = rightPart;
+            }
+            bins.aabb[last].combine(rest);
+            bins.entries[first]++;
+            bins.exits[last]++;
+        }
+        int split = sweepBins<BVH_SBVH_BINS>(bins.aabb, bins.entries, bins.exits, costs[a]);
+        positions[a] = low[a] + split * width;
+        if (split < 0)
+            costs[a] = FLT_MAX;
+    };
+    bool parallel = references.size() >= BVH_PARALLEL_THRESHOLD;
+    for (int a = 0; a < 3; a++)
+    {
+        if (extent[a] < EPSILON)
+            continue;
+        if (parallel)
+        {
+#pragma omp task shared(binAxis) firstprivate(a)
+            binAxis(a);
+        }
+        else
+            binAxis(a);
+    }
+    if (parallel)
+    {
+#pragma omp taskwait
+    }
+    float bestCost = FLT_MAX;
+    for (int a = 0; a < 3; a++)
+        if (costs[a] < bestCost)
+        {
+            bestCost = costs[a];
+            axis = a;
+            position = positions[a];
+        }
+    return bestCost;
+}
+
+int BVHBuilder::partitionSpatial(const std::vector<SBVHReference> &references, int axis, float position, std::vector<SBVHReference> &left, std::vector<SBVHReference> &right) const
+{
+    // 先分配完全位于一侧的引用
+    AABB leftBox, rightBox;
+    std::vector<const SBVHReference *> straddling;
+    for (const SBVHReference &reference : references)
+    {
+        if (reference.aabb.getMax()[axis] <= position)
+        {
+            left.push_back(reference);
+            leftBox.combine(reference.aabb);
+        }
+        else if (reference.aabb.getMin()[axis] >= position)
+        {
+            right.push_back(reference);
+            rightBox.combine(reference.aabb);
+        }
+        else
+            straddling.push_back(&reference);
+    }
+
+    // 跨越平面的引用：比较裁剪到两侧与整体放入某一侧（反拆分）的代价
+    int duplicates = 0;
+    for (const SBVHReference *reference : straddling)
+    {
+        AABB leftPart, rightPart;
+        splitReference(reference->index, reference->aabb, axis, position, leftPart, rightPart);
+        float leftCount = (float)left.size(), rightCount = (float)right.size();
+        AABB leftSplit = leftBox, rightSplit = rightBox, leftWhole = leftBox, rightWhole = rightBox;
+        leftSplit.combine(leftPart);
+        rightSplit.combine(rightPart);
+        leftWhole.combine(reference->aabb);
+        rightWhole.combine(reference->aabb);
+        float splitCost = leftSplit.surfaceArea() * (leftCount + 1) + rightSplit.surfaceArea() * (rightCount + 1);
+        float leftCost = leftWhole.surfaceArea() * (leftCount + 1) + rightBox.surfaceArea() * rightCount;
+        float rightCost = leftBox.surfaceArea() * leftCount + rightWhole.surfaceArea() * (rightCount + 1);
+        // 三角形实际只落在一侧时裁剪结果有一侧为空
+        if (leftPart.isEmpty() || rightPart.isEmpty())
+            splitCost = FLT_MAX;
+
+        if (splitCost < leftCost && splitCost < rightCost)
+        {
+            left.push_back({reference->index, leftPart});
+            right.push_back({reference->index, rightPart});
+            leftBox = leftSplit;
+            rightBox = rightSplit;
+            duplicates++;
+        }
+        else if (leftCost <= rightCost && !leftPart.isEmpty())
+        {
+            left.push_back(*reference);
+            leftBox = leftWhole;
+        }
+        else
+        {
+            right.push_back(*reference);
+            rightBox = rightWhole;
+        }
+    }
+    return duplicates;
+}
+
+void BVHBuilder::splitReference(int index, const AABB &aabb, int axis, float position, AABB &left, AABB &right) const
+{
+    // 遍历三角形的三条边：顶点按所在侧加入对应包围盒，与平面相交的边的交点同时加入两侧
+    // 该函数在空间划分分桶时调用非常频繁，先用局部变量统计两侧的范围再构造AABB
+    const QVector3D *v = &(*vertices)[3 * index];
+    QVector3D leftMin(FLT_MAX, FLT_MAX, FLT_MAX), leftMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    QVector3D rightMin = leftMin, rightMax = leftMax;
+    for (int i = 0; i < 3; i++)
+    {
+        const QVector3D &p = v[i], &q = v[(i + 1) % 3];
+        float pa = p[axis], qa = q[axis];
+        if (pa <= position)
+        {
+            leftMin = minVector(leftMin, p);
+            leftMax = maxVector(leftMax, p);
+        }
+        if (pa >= position)
+        {
+            rightMin = minVector(rightMin, p);
+            rightMax = maxVector(rightMax, p);
+        }
+        if ((pa < position && qa > position) || (pa > position && qa < position))
+        {
+            QVector3D x = p + (q - p) * ((position - pa) / (qa - pa));
+            x[axis] = position;
+            leftMin = minVector(leftMin, x);
+            leftMax = maxVector(leftMax, x);
+            rightMin = minVector(rightMin, x);
+            rightMax = maxVector(rightMax, x);
+        }
+    }
+    left = AABB();
+    right = AABB();
+    if (leftMin.x() <= leftMax.x())
+    {
+        left.add(leftMin);
+        left.add(leftMax);
+    }
+    if (rightMin.x() <= rightMax.x())
+    {
+        right.add(rightMin);
+        right.add(rightMax);
+    }
+    // 引用本身可能已被裁剪过，结果不能超出原来的范围
+    left.intersect(aabb);
+    right.intersect(aabb);
+}
@@ -0,0 +1,176 @@
+#include "Denoiser.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include <omp.h>
+
+AOVBuffers::AOVBuffers(int width, int height) : albedo(width, height), normal(width, height), depth(width, height) {}
+
+// max(v, 0)，不用比较与分支，默认的-ftrapping-math下编译器不会把浮点的条件表达式转为向量的select
+static inline float positive(float v)
+{
+    return 0.5f * (v + std::fabs(v));
+}
+
+// x <= 0时的exp近似：2^t = 2^i * 2^f，f∈(-1,0]上用四次多项式，只有算术运算，循环可以向量化
+static inline float fastExp(float x)
+{
+    float t = (positive(x + 80.0f) - 80.0f) * 1.442695041f;
+    int i = (int)t;
+    float f = t - (float)i;
+    float p = 1.0f + f * (0.6931472f + f * (0.2402265f + f * (0.0555041f + f * 0.0096181f)));
+    int32_t bits = (i + 127) << 23;
+    float scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+    return p * scale;
+}
+
+// 一行像素与某个偏移处的邻域像素，p为当前行，q为邻域所在行
+struct TapRows
+{
+    const float *keyP, *keyQ, *normalP[3], *normalQ[3], *depthP, *depthQ, *colorQ[3];
+};
+
+// 对当前行[x0, x1)内的像素累加偏移为offset的邻域像素的贡献，clamp为true时邻域下标截断到图像内
+template <bool clamp>
+static inline void accumulate(const TapRows &rows, int width, int offset, int x0, int x1, float h, float invColor, float invNormal, float depthScale, float *sum[4])
+{
+    float *sumR = sum[0], *sumG = sum[1], *sumB = sum[2], *sumW = sum[3];
+#pragma omp simd
+    for (int x = x0; x < x1; x++)
+    {
+        int q = x + offset;
+        if (clamp)
+            q = q < 0 ? 0 : (q > width - 1 ? width - 1 : q);
+        // 照度差异（压缩后的亮度）、法线夹角与相对深度差异三项边缘停止函数合并为一次exp
+        float dc = rows.keyP[x] - rows.keyQ[q];
+        float cosine = rows.normalP[0][x] * rows.normalQ[0][q] + rows.normalP[1][x] * rows.normalQ[1][q] + rows.normalP[2][x] * rows.normalQ[2][q];
+        float dd = (rows.depthP[x] - rows.depthQ[q]) / (depthScale * rows.depthP[x] + 1e-4f);
+        float energy = dc * dc * invColor + positive(1.0f - cosine) * invNormal + dd * dd;
+        float weight = h * fastExp(-energy);
+        sumR[x] += weight * rows.colorQ[0][q];
+        sumG[x] += weight * rows.colorQ[1][q];
+        sumB[x] += weight * rows.colorQ[2][q];
+        sumW[x] += weight;
+    }
+}
+
+Denoiser::Denoiser(int width, int height) : width(width), height(height)
+{
+    size_t count = (size_t)width * height;
+    for (int c = 0; c < 3; c++)
+    {
+        color[c].assign(count, 0.0f);
+        albedo[c].assign(count, 0.0f);
+        normal[c].assign(count, 0.0f);
+        filtered[c].assign(count, 0.0f);
+    }
+    depth.assign(count, 0.0f);
+    key.assign(count, 0.0f);
+}
+
+Denoiser::~Denoiser() {}
+
+void Denoiser::iterate(int iteration)
+{
+    // B3样条核
+    static const float kernel[5] = {1.0f / 16.0f, 1.0f / 4.0f, 3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f};
+    int step = 1 << iteration;
+    // 照度的容差每次迭代减半（Dammertz 2010），深度的容差随采样间隔增大
+    float sigmaColor = DENOISER_SIGMA_COLOR / (float)step;
+    float invColor = 1.0f / (sigmaColor * sigmaColor);
+    float invNormal = 1.0f / DENOISER_SIGMA_NORMAL;
+    float depthScale = DENOISER_SIGMA_DEPTH * (float)step;
+
+    for (size_t p = 0; p < key.size(); p++)
+    {
+        float luminance = std::max((color[0][p] + color[1][p] + color[2][p]) / 3.0f, 0.0f);
+        key[p] = luminance / (1.0f + luminance);
+    }
+
+#pragma omp parallel
+    {
+        std::vector<float> sums[4];
+        for (std::vector<float> &sum : sums)
+            sum.resize(width);
+#pragma omp for schedule(dynamic)
+        for (int y = 0; y < height; y++)
+        {
+            for (std::vector<float> &sum : sums)
+                std::fill(sum.begin(), sum.end(), 0.0f);
+            float *sum[4] = {sums[0].data(), sums[1].data(), sums[2].data(), sums[3].data()};
+            size_t rowP = (size_t)y * width;
+            for (int dy = -2; dy <= 2; dy++)
+            {
+                int qy = std::min(std::max(y + dy * step, 0), height - 1);
+                size_t rowQ = (size_t)qy * width;
+                TapRows rows;
+                rows.keyP = &key[rowP];
+                rows.keyQ = &key[rowQ];
+                rows.depthP = &depth[rowP];
+                rows.depthQ = &depth[rowQ];
+                for (int c = 0; c < 3; c++)
+                {
+                    rows.normalP[c] = &normal[c][rowP];
+                    rows.normalQ[c] = &normal[c][rowQ];
+                    rows.colorQ[c] = &color[c][rowQ];
+                }
+                for (int dx = -2; dx <= 2; dx++)
+                {
+                    int offset = dx * step;
+                    float h = kernel[dy + 2] * kernel[dx + 2];
+                    // 邻域下标不越界的中间部分连续访问，两端截断到边界
+                    int x0 = std::min(std::max(-offset, 0), width), x1 = std::max(std::min(width - offset, width), x0);
+                    accumulate<true>(rows, width, offset, 0, x0, h, invColor, invNormal, depthScale, sum);
+                    accumulate<false>(rows, width, offset, x0, x1, h, invColor, invNormal, depthScale, sum);
+                    accumulate<true>(rows, width, offset, x1, width, h, invColor, invNormal, depthScale, sum);
+                }
+            }
+            for (int x = 0; x < width; x++)
+                for (int c = 0; c < 3; c++)
+                    filtered[c][rowP + x] = sums[3][x] > 0.0f ? sums[c][x] / sums[3][x] : color[c][rowP + x];
+        }
+    }
+}
+
+void Denoiser::denoise(const Framebuffer &beauty, const AOVBuffers &aovs, Framebuffer &output)
+{
+    // 用反照率解调得到照度，反照率为0的通道（如没有交点）保留原值
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+        {
+            size_t p = (size_t)y * width + x;
+            QVector3D c = beauty.getColor(x, y), a = aovs.albedo.getColor(x, y), n = aovs.normal.getColor(x, y);
+            if (n.lengthSquared() > 0.0f)
+                n.normalize();
+            for (int k = 0; k < 3; k++)
+            {
+                albedo[k][p] = a[k];
+                color[k][p] = a[k] > DENOISER_ALBEDO_EPSILON ? c[k] / a[k] : c[k];
+                normal[k][p] = n[k];
+            }
+            depth[p] = aovs.depth.getColor(x, y).x();
+        }
+
+    for (int i = 0; i < DENOISER_ITERATIONS; i++)
+    {
+        iterate(i);
+        for (int c = 0; c < 3; c++)
+            color[c].swap(filtered[c]);
+    }
+
+    // 乘回反照率
+    output.clear();
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+        {
+            size_t p = (size_t)y * width + x;
+            QVector3D value;
+            for (int k = 0; k < 3; k++)
+                value[k] = albedo[k][p] > DENOISER_ALBEDO_EPSILON ? color[k][p] * albedo[k][p] : color[k][p];
+            output.add(x, y, value);
+        }
+}
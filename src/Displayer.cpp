@@ -45,6 +45,14 @@ Displayer::Displayer() : QWidget()
     grid.addWidget(&sppLabel, 0, 0);
     grid.addWidget(&sppEdit, 0, 1);
 
+    adaptiveBox.setParent(this);
+    adaptiveBox.setText("自适应采样");
+    grid.addWidget(&adaptiveBox, 1, 0, 1, 2);
+
+    denoiseBox.setParent(this);
+    denoiseBox.setText("降噪");
+    grid.addWidget(&denoiseBox, 2, 0, 1, 2);
+
     iterationLabel.setParent(this);
     iterationLabel.setText(QString("Iteration: 0"));
 
@@ -89,11 +97,19 @@ Displayer::Displayer() : QWidget()
 
 Displayer::~Displayer() {}
 
-void Displayer::refresh(const std::vector<std::vector<QVector3D>> &sum, const int sample)
+void Displayer::refresh(const Framebuffer &frame)
 {
-    for (int i = 0; i < sum.size(); i++)
-        for (int j = 0; j < sum[i].size(); j++)
-            image.setPixel(i, j, vectorToColor(sum[i][j] / (float)sample).rgb());
+    if (denoiser)
+    {
+        Framebuffer denoised(frame.getWidth(), frame.getHeight());
+        denoiser->denoise(frame, *aovs, denoised);
+        denoised.toImage(image);
+    }
+    else
+        frame.toImage(image);
+    // 自适应采样时根据每个像素的样本数更新样本数图
+    if (!sampleMap.isNull())
+        frame.weightsToImage(sampleMap);
 
     imageLabel.setPixmap(QPixmap::fromImage(image));
 }
@@ -138,19 +154,44 @@ void Displayer::calculate()
     int width = cam.getWidth();
     int height = cam.getHeight();
 
-    std::vector<std::vector<QVector3D>> sum(width, std::vector<QVector3D>(height, QVector3D(0.0f, 0.0f, 0.0f)));
     image = QImage(width, height, QImage::Format_RGB32);
+    sampleMap = QImage();
     spdlog::set_level(spdlog::level::trace);
     spdlog::info("开始采样生成图像");
     double start = cpuSecond();
-    for (int i = 0; i < SAMPLE_PER_PIXEL; i++)
+    Framebuffer frame(width, height);
+    aovs.reset(denoiseBox.isChecked() ? new AOVBuffers(width, height) : nullptr);
+    denoiser.reset(denoiseBox.isChecked() ? new Denoiser(width, height) : nullptr);
+    if (adaptiveBox.isChecked())
     {
-        scene.sample(cam, sum);
-        iterationLabel.setText(QString("Iteration: %1").arg(i + 1));
+        // 每轮只采样未收敛的像素，全部收敛或达到样本数上限时结束
+        PixelStatisticsBuffer pixels(width, height);
+        sampleMap = QImage(width, height, QImage::Format_RGB32);
+        long long total = 0;
+        for (int i = 0;; i++)
+        {
+            int active = scene.sampleAdaptive(cam, pixels, frame, SAMPLE_PER_PIXEL, aovs.get());
+            if (active == 0)
+                break;
+            total += active;
+            iterationLabel.setText(QString("Iteration: %1 (%2 samples)").arg(i + 1).arg(active));
+            timeLabel.setText(QString("Time: %1").arg(cpuSecond() - start));
+            QCoreApplication::processEvents();
+            refresh(frame);
+        }
+        spdlog::info("自适应采样完毕，平均每像素{:.2f}个样本，共花费: {:.6f}s", (double)total / ((double)width * height), cpuSecond() - start);
+        return;
+    }
+    // 每轮每个渲染任务连续采样RENDER_TILE_SAMPLES次，轮与轮之间刷新图像
+    for (int i = 0; i < SAMPLE_PER_PIXEL; i += RENDER_TILE_SAMPLES)
+    {
+        int samples = std::min(RENDER_TILE_SAMPLES, SAMPLE_PER_PIXEL - i);
+        scene.render(cam, frame, samples, nullptr, aovs.get());
+        iterationLabel.setText(QString("Iteration: %1").arg(i + samples));
         double end = cpuSecond();
         timeLabel.setText(QString("Time: %1").arg(end - start));
         QCoreApplication::processEvents();
-        refresh(sum, i + 1);
+        refresh(frame);
     }
     double end = cpuSecond();
     spdlog::info("采样生成图像完毕，共花费: {:.6f}s", end - start);
@@ -160,4 +201,10 @@ void Displayer::save()
 {
     QString path = QFileDialog::getSaveFileName(this, "保存标题", ".", "PNG files (*.png)");
     image.save(path);
+    // 自适应采样时同时保存样本数图
+    if (!sampleMap.isNull())
+    {
+        QString base = path.endsWith(".png", Qt::CaseInsensitive) ? path.left(path.size() - 4) : path;
+        sampleMap.save(base + "_samples.png");
+    }
 }
@@ -0,0 +1,141 @@
+#include "Framebuffer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "UtilsHelper.h"
+
+Framebuffer::Framebuffer() : width(0), height(0), stride(0), pixels(nullptr) {}
+
+Framebuffer::Framebuffer(int width, int height) : width(width), height(height)
+{
+    int perLine = ALIGNMENT / (CHANNELS * sizeof(float));
+    stride = (width + perLine - 1) / perLine * perLine;
+    storage.assign((size_t)stride * height * CHANNELS + ALIGNMENT / sizeof(float), 0.0f);
+    uintptr_t address = reinterpret_cast<uintptr_t>(storage.data());
+    pixels = storage.data() + ((ALIGNMENT - address % ALIGNMENT) % ALIGNMENT) / sizeof(float);
+}
+
+Framebuffer::Framebuffer(const Framebuffer &other) : Framebuffer(other.width, other.height)
+{
+    if (height > 0)
+        std::memcpy(pixels, other.pixels, (size_t)stride * height * CHANNELS * sizeof(float));
+}
+
+Framebuffer &Framebuffer::operator=(const Framebuffer &other)
+{
+    if (this != &other)
+    {
+        // 复制后storage的地址会变化，需要重新计算对齐的起始位置
+        Framebuffer copy(other);
+        width = copy.width;
+        height = copy.height;
+        stride = copy.stride;
+        storage.swap(copy.storage);
+        pixels = copy.pixels;
+    }
+    return *this;
+}
+
+Framebuffer::~Framebuffer() {}
+
+int Framebuffer::getWidth() const
+{
+    return width;
+}
+
+int Framebuffer::getHeight() const
+{
+    return height;
+}
+
+int Framebuffer::getStride() const
+{
+    return stride;
+}
+
+float *Framebuffer::row(int y)
+{
+    return pixels + (size_t)y * stride * CHANNELS;
+}
+
+const float *Framebuffer::row(int y) const
+{
+    return pixels + (size_t)y * stride * CHANNELS;
+}
+
+void Framebuffer::add(int x, int y, const QVector3D &radiance, float weight)
+{
+    float *pixel = row(y) + x * CHANNELS;
+    pixel[0] += radiance.x();
+    pixel[1] += radiance.y();
+    pixel[2] += radiance.z();
+    pixel[3] += weight;
+}
+
+float Framebuffer::getWeight(int x, int y) const
+{
+    return row(y)[x * CHANNELS + 3];
+}
+
+QVector3D Framebuffer::getColor(int x, int y) const
+{
+    const float *pixel = row(y) + x * CHANNELS;
+    if (pixel[3] <= 0.0f)
+        return QVector3D(0.0f, 0.0f, 0.0f);
+    return QVector3D(pixel[0], pixel[1], pixel[2]) / pixel[3];
+}
+
+void Framebuffer::clear()
+{
+    if (height > 0)
+        std::fill(pixels, pixels + (size_t)stride * height * CHANNELS, 0.0f);
+}
+
+void Framebuffer::merge(const Framebuffer &other)
+{
+    size_t count = (size_t)stride * height * CHANNELS;
+    for (size_t i = 0; i < count; i++)
+        pixels[i] += other.pixels[i];
+}
+
+void Framebuffer::mergeRegion(Framebuffer &other, int x0, int y0, int x1, int y1)
+{
+    for (int y = y0; y < y1; y++)
+    {
+        float *target = row(y) + x0 * CHANNELS, *source = other.row(y) + x0 * CHANNELS;
+        for (int i = 0; i < (x1 - x0) * CHANNELS; i++)
+        {
+            target[i] += source[i];
+            source[i] = 0.0f;
+        }
+    }
+}
+
+void Framebuffer::toImage(QImage &image) const
+{
+    for (int y = 0; y < height; y++)
+    {
+        QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+        for (int x = 0; x < width; x++)
+            line[x] = vectorToColor(getColor(x, y)).rgb();
+    }
+}
+
+void Framebuffer::weightsToImage(QImage &image) const
+{
+    float maxWeight = 1.0f;
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            maxWeight = std::max(maxWeight, getWeight(x, y));
+    for (int y = 0; y < height; y++)
+    {
+        QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+        for (int x = 0; x < width; x++)
+        {
+            int gray = (int)(getWeight(x, y) / maxWeight * 255.0f);
+            line[x] = qRgb(gray, gray, gray);
+        }
+    }
+}
@@ -10,7 +10,24 @@ Material::Material(const QVector3D &diffuse, const QVector3D &specular, const QV
                                                                                                                                                                                                    ior(ior),
                                                                                                                                                                                                    threshold_method(threshold_method)
 {
+    computeThreshold();
+}
 
+// 从缓存读取时按构造时的顺序读出各参数
+Material::Material(CacheReader &reader, bool threshold_method) : threshold_method(threshold_method)
+{
+    for (QVector3D *vector : {&diffuse, &specular, &emissive, &transmittance})
+        for (int i = 0; i < 3; i++)
+            (*vector)[i] = reader.read<float>();
+    shininess = reader.read<float>();
+    ior = reader.read<float>();
+    computeThreshold();
+}
+
+Material::~Material() {}
+
+void Material::computeThreshold()
+{
     // 没有镜面反射分量，此时只能按照漫反射pdf进行重要性采样生成光线
     if (specular.isNull())
         threshold = 1.0f + EPSILON;
@@ -27,12 +44,19 @@ Material::Material(const QVector3D &diffuse, const QVector3D &specular, const QV
         {
             float maxdiffuse = qMax(qMax(diffuse.x(), diffuse.y()), diffuse.z());
             float maxspecular = qMax(qMax(specular.x(), specular.y()), specular.z());
-            float t = maxdiffuse / (maxdiffuse + maxspecular);
+            threshold = maxdiffuse / (maxdiffuse + maxspecular);
         }
     }
 }
 
-Material::~Material() {}
+void Material::save(CacheWriter &writer) const
+{
+    for (const QVector3D *vector : {&diffuse, &specular, &emissive, &transmittance})
+        for (int i = 0; i < 3; i++)
+            writer.write<float>((*vector)[i]);
+    writer.write<float>(shininess);
+    writer.write<float>(ior);
+}
 
 QVector3D Material::getEmissive() const
 {
@@ -43,6 +67,14 @@ float Material::getIor() const
     return ior;
 }
 
+QVector3D Material::albedo(const QVector3D &color) const
+{
+    if (ior > 1)
+        return transmittance;
+    QVector3D sum = diffuse * color + specular;
+    return QVector3D(std::min(sum.x(), 1.0f), std::min(sum.y(), 1.0f), std::min(sum.z(), 1.0f));
+}
+
 float Material::getThreshold() const
 {
     return threshold;
@@ -70,12 +102,14 @@ void Material::sample(const QVector3D &normal, const QVector3D &reflection, cons
 {
     float theta, phi;
     QVector3D tangent, bitangent;
+    // 先取出射方向的两维再取选择波瓣的一维，使方向的两维在低差异序列中成对
+    float u1 = randomUniform(), u2 = randomUniform();
     // 为了生成出射光线，需要概率进行判断是根据漫反射还是高光反射射出光线
     if (randomUniform() <= threshold)
     {
         // 考虑cos 的 重要性采样
         // 漫反射时theta为出射光线与法向量的夹角
-        sampleHemisphere(1.0f, theta, phi);
+        sampleHemisphere(1.0f, u1, u2, theta, phi);
         float cosine = std::cos(theta);
         float sine = std::sin(theta);
         calculateTangentSpace(normal, tangent, bitangent);
@@ -87,7 +121,7 @@ void Material::sample(const QVector3D &normal, const QVector3D &reflection, cons
     {
         // 考虑cos^n 的重要性采样
         //  高光反射时theta为半程向量和法向量的夹角
-        sampleHemisphere(shininess, theta, phi);
+        sampleHemisphere(shininess, u1, u2, theta, phi);
         float cosine = std::cos(theta);
         float sine = std::sin(theta);
 
@@ -100,13 +134,31 @@ void Material::sample(const QVector3D &normal, const QVector3D &reflection, cons
 
         // direction = 2 * half - tempray.reflect(half);
 
-        if (QVector3D::dotProduct(normal, direction) < 0.0f)
-            direction = cosine * reflection - sine * std::cos(phi) * tangent - sine * std::sin(phi) * bitangent;
+        // 落到表面以下的方向直接丢弃（通量为0），不关于反射方向镜像：镜像会使表面附近的方向被采到两次，
+        // 实际密度不再是pdf()中的(n+1)/(2*pi)*cos(alpha)^n，MIS权重与通量都会出错
+        if (QVector3D::dotProduct(normal, direction) <= 0.0f)
+        {
+            albedo = QVector3D(0.0f, 0.0f, 0.0f);
+            return;
+        }
 
         albedo = specular * (shininess + 2) / (shininess + 1) * std::max(QVector3D::dotProduct(direction, normal), 0.0f);
     }
 }
 
+// 漫反射：pdf = cos(theta)/pi，theta为出射方向与法线的夹角
+// 镜面反射：pdf = (n+1)/(2*pi)*cos(alpha)^n，alpha为出射方向与完美镜面反射方向的夹角
+float Material::pdf(const QVector3D &normal, const QVector3D &reflection, const QVector3D &direction) const
+{
+    float cosine = QVector3D::dotProduct(normal, direction);
+    if (cosine <= 0.0f)
+        return 0.0f;
+    float t = std::min(threshold, 1.0f);
+    float diffusePdf = cosine / PI;
+    float specularPdf = (shininess + 1.0f) / (2.0f * PI) * std::pow(std::max(QVector3D::dotProduct(reflection, direction), 0.0f), shininess);
+    return t * diffusePdf + (1.0f - t) * specularPdf;
+}
+
 // 计算菲涅尔系数
 float schlick(float cosine, float ref_idx)
 {
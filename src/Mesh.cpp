@@ -1,29 +1,46 @@
 #include "Mesh.h"
 
-Mesh::Mesh(const std::vector<Triangle> &triangles, const Material &material, const Texture &texture) : triangles(triangles),
-                                                                                                       bvh(triangles),
-                                                                                                       material(material),
-                                                                                                       texture(texture)
-{
-    area = 0.0f;
-    for (const Triangle &triangle : this->triangles)
-    {
-        float temp = triangle.area();
-        areas.push_back(temp);
-        area += temp;
-    }
-}
+Mesh::Mesh(const std::vector<Triangle> &triangles, int materialId, const Texture &texture) : triangles(triangles),
+                                                                                             bvh(triangles),
+                                                                                             materialId(materialId),
+                                                                                             texture(texture) {}
+
+Mesh::Mesh(CacheReader &reader) : triangles(reader.viewArray<Triangle>()),
+                                  bvh(this->triangles.size(), reader),
+                                  materialId(reader.read<int32_t>()),
+                                  texture(reader) {}
 
 Mesh::~Mesh() {}
 
+void Mesh::save(CacheWriter &writer) const
+{
+    writer.writeArray(triangles);
+    bvh.save(writer);
+    writer.write<int32_t>(materialId);
+    texture.save(writer);
+}
+
 float Mesh::getArea() const
 {
+    float area = 0.0f;
+    for (const Triangle &triangle : triangles)
+        area += triangle.area();
     return area;
 }
 
-Material Mesh::getMaterial() const
+const CacheArray<Triangle> &Mesh::getTriangles() const
+{
+    return triangles;
+}
+
+AABB Mesh::getAABB() const
 {
-    return material;
+    return bvh.getAABB();
+}
+
+int Mesh::getMaterialId() const
+{
+    return materialId;
 }
 
 QVector3D Mesh::color(const QVector2D &uv) const
@@ -31,25 +48,22 @@ QVector3D Mesh::color(const QVector2D &uv) const
     return texture.color(uv);
 }
 
-void Mesh::trace(const Ray &ray, float &t, Point &point) const
+bool Mesh::trace(const Ray &ray, HitRecord &hit) const
+{
+    return bvh.trace(ray, hit);
+}
+
+uint64_t Mesh::tracePacket(const RayPacket &packet, uint64_t mask, HitPacket &hit) const
+{
+    return bvh.tracePacket(packet, mask, hit);
+}
+
+Point Mesh::interpolate(const Ray &ray, const HitRecord &hit) const
 {
-    return bvh.trace(ray, t, point);
+    return triangles[hit.primitive].interpolate(ray.point(hit.t), hit.u, hit.v);
 }
 
-// 根据网格中三角形的面积进行随机采样
-Point Mesh::sample(Point point) const
+bool Mesh::occluded(const Ray &ray) const
 {
-    int trycount = 0;
-    Point temppoint;
-    float t = randomUniform() * area;
-    for (int i = 0; i < triangles.size(); i++)
-    {
-        t -= areas[i];
-        if (t <= 0.0f)
-        {
-            temppoint = triangles[i].sample();
-            break;
-        }
-    }
-    return temppoint;
+    return bvh.occluded(ray);
 }
\ No newline at end of file
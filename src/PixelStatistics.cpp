@@ -0,0 +1,65 @@
+#include "PixelStatistics.h"
+
+#include <cfloat>
+#include <cmath>
+
+PixelStatistics::PixelStatistics() : count(0), mean(0.0f, 0.0f, 0.0f), m2(0.0f, 0.0f, 0.0f) {}
+
+PixelStatistics::~PixelStatistics() {}
+
+void PixelStatistics::add(const QVector3D &sample)
+{
+    count++;
+    QVector3D delta = sample - mean;
+    mean += delta / (float)count;
+    m2 += delta * (sample - mean);
+}
+
+int PixelStatistics::getCount() const
+{
+    return count;
+}
+
+QVector3D PixelStatistics::getMean() const
+{
+    return mean;
+}
+
+float PixelStatistics::relativeError() const
+{
+    if (count < 2)
+        return FLT_MAX;
+    // 三个通道的平均样本方差，除以样本数得到均值的方差
+    float variance = (m2.x() + m2.y() + m2.z()) / (3.0f * (count - 1));
+    float luminance = (mean.x() + mean.y() + mean.z()) / 3.0f;
+    return std::sqrt(variance / count) / (luminance + ADAPTIVE_ERROR_EPSILON);
+}
+
+bool PixelStatistics::isConverged() const
+{
+    return count >= ADAPTIVE_MIN_SAMPLES && relativeError() < ADAPTIVE_ERROR_THRESHOLD;
+}
+
+PixelStatisticsBuffer::PixelStatisticsBuffer(int width, int height) : width(width), height(height), pixels((size_t)width * height) {}
+
+PixelStatisticsBuffer::~PixelStatisticsBuffer() {}
+
+int PixelStatisticsBuffer::getWidth() const
+{
+    return width;
+}
+
+int PixelStatisticsBuffer::getHeight() const
+{
+    return height;
+}
+
+PixelStatistics &PixelStatisticsBuffer::at(int x, int y)
+{
+    return pixels[(size_t)y * width + x];
+}
+
+const PixelStatistics &PixelStatisticsBuffer::at(int x, int y) const
+{
+    return pixels[(size_t)y * width + x];
+}
@@ -8,8 +8,6 @@ Point::Point(const QVector3D &position, const QVector3D &normal, const QVector2D
                                                                                         normal(normal),
                                                                                         uv(uv) {}
 
-Point::~Point() {}
-
 QVector3D Point::getPosition() const
 {
     return position;
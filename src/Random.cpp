@@ -0,0 +1,34 @@
+#include "Random.h"
+
+PCG32::PCG32()
+{
+    seed(0x853c49e6748fea9bULL, 0xda3e39cb94b95bdbULL);
+}
+
+void PCG32::seed(uint64_t initState, uint64_t sequence)
+{
+    state = 0;
+    increment = (sequence << 1u) | 1u;
+    next();
+    state += initState;
+    next();
+}
+
+// 线性同余的跳跃：x -> a^n x + c(a^(n-1) + ... + 1)，按二进制位平方累积
+void PCG32::advance(uint64_t delta)
+{
+    uint64_t multiplier = 6364136223846793005ULL, increment = this->increment;
+    uint64_t accMultiplier = 1, accIncrement = 0;
+    while (delta > 0)
+    {
+        if (delta & 1)
+        {
+            accMultiplier *= multiplier;
+            accIncrement = accIncrement * multiplier + increment;
+        }
+        increment = (multiplier + 1) * increment;
+        multiplier *= multiplier;
+        delta >>= 1;
+    }
+    state = accMultiplier * state + accIncrement;
+}
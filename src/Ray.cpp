@@ -1,7 +1,10 @@
 #include "Ray.h"
 
-Ray::Ray(const QVector3D &origin, const QVector3D &direction) : origin(origin),
-                                                                direction(direction) {}
+Ray::Ray(const QVector3D &origin, const QVector3D &direction, const float tmin, const float tmax) : origin(origin),
+                                                                                                 direction(direction),
+                                                                                                 invDirection(1.0f / direction.x(), 1.0f / direction.y(), 1.0f / direction.z()),
+                                                                                                 tmin(tmin),
+                                                                                                 tmax(tmax) {}
 
 Ray::~Ray() {}
 
@@ -15,6 +18,26 @@ QVector3D Ray::getDirection() const
     return direction;
 }
 
+QVector3D Ray::getInvDirection() const
+{
+    return invDirection;
+}
+
+float Ray::getTMin() const
+{
+    return tmin;
+}
+
+float Ray::getTMax() const
+{
+    return tmax;
+}
+
+void Ray::setTMax(const float t)
+{
+    tmax = t;
+}
+
 QVector3D Ray::point(const float t) const
 {
     return origin + t * direction;
@@ -0,0 +1,196 @@
+#include "RayPacket.h"
+
+#include <cmath>
+#include <algorithm>
+
+#if defined(__SSE__)
+#include <immintrin.h>
+#endif
+
+RayPacket::RayPacket(const std::vector<Ray> &rays) : size(std::min((int)rays.size(), MAX_SIZE)), coherent(size > 0), minTMin(FLT_MAX)
+{
+    for (int a = 0; a < 3; a++)
+    {
+        originMin[a] = invMin[a] = FLT_MAX;
+        originMax[a] = invMax[a] = -FLT_MAX;
+        sign[a] = size > 0 && rays[0].getDirection()[a] < 0.0f ? 1 : 0;
+    }
+    for (int i = 0; i < size; i++)
+    {
+        QVector3D o = rays[i].getOrigin(), d = rays[i].getDirection();
+        for (int a = 0; a < 3; a++)
+        {
+            origin[a][i] = o[a];
+            direction[a][i] = d[a];
+            // 与WideRay相同，避免0*inf产生NaN
+            invDirection[a][i] = std::fabs(d[a]) > EPSILON ? 1.0f / d[a] : (d[a] < 0.0f ? -1.0f : 1.0f) / EPSILON;
+            originMin[a] = std::min(originMin[a], o[a]);
+            originMax[a] = std::max(originMax[a], o[a]);
+            invMin[a] = std::min(invMin[a], invDirection[a][i]);
+            invMax[a] = std::max(invMax[a], invDirection[a][i]);
+            if ((d[a] < 0.0f ? 1 : 0) != sign[a])
+                coherent = false;
+        }
+        tmin[i] = rays[i].getTMin();
+        tmax[i] = rays[i].getTMax();
+        minTMin = std::min(minTMin, tmin[i]);
+        meanDirection += d;
+    }
+    QVector3D axis = meanDirection.normalized();
+    spread = 1.0f;
+    for (int i = 0; i < size; i++)
+        spread = std::min(spread, direction[0][i] * axis.x() + direction[1][i] * axis.y() + direction[2][i] * axis.z());
+    // 补齐到4的倍数，补齐的光线不在掩码中，只是避免SIMD读到未初始化的数据
+    for (int i = size; i < (size + 3) / 4 * 4; i++)
+    {
+        for (int a = 0; a < 3; a++)
+            origin[a][i] = direction[a][i] = invDirection[a][i] = 0.0f;
+        tmin[i] = tmax[i] = 0.0f;
+    }
+}
+
+RayPacket::~RayPacket() {}
+
+int RayPacket::getSize() const
+{
+    return size;
+}
+
+bool RayPacket::isCoherent() const
+{
+    return coherent;
+}
+
+float RayPacket::getSpread() const
+{
+    return spread;
+}
+
+uint64_t RayPacket::getMask() const
+{
+    return size == MAX_SIZE ? ~0ULL : (1ULL << size) - 1;
+}
+
+Ray RayPacket::getRay(int i) const
+{
+    return Ray(QVector3D(origin[0][i], origin[1][i], origin[2][i]), QVector3D(direction[0][i], direction[1][i], direction[2][i]), tmin[i], tmax[i]);
+}
+
+float RayPacket::getTMax(int i) const
+{
+    return tmax[i];
+}
+
+const float *RayPacket::getOrigin(int axis) const
+{
+    return origin[axis];
+}
+
+const float *RayPacket::getDirection(int axis) const
+{
+    return direction[axis];
+}
+
+const float *RayPacket::getTMin() const
+{
+    return tmin;
+}
+
+// 区间乘法：[a0, a1] * [b0, b1]的最小值与最大值
+static inline void multiply(float a0, float a1, float b0, float b1, float &lower, float &upper)
+{
+    float p0 = a0 * b0, p1 = a0 * b1, p2 = a1 * b0, p3 = a1 * b1;
+    lower = std::min(std::min(p0, p1), std::min(p2, p3));
+    upper = std::max(std::max(p0, p1), std::max(p2, p3));
+}
+
+uint64_t RayPacket::intersect(const AABB &aabb, uint64_t mask, const float *t) const
+{
+    if (mask == 0)
+        return 0;
+    QVector3D bounds[2] = {aabb.getMin(), aabb.getMax()};
+
+    // 视锥剔除：用区间算术得到所有光线进入距离的下界与离开距离的上界，
+    // 下界大于上界时没有任何光线与包围盒相交（方向符号一致时该测试才是保守的）
+    float tMaxMax = -FLT_MAX;
+    for (int i = 0; i < size; i++)
+        if ((mask >> i) & 1)
+            tMaxMax = std::max(tMaxMax, t[i]);
+    float lower = minTMin, upper = tMaxMax;
+    for (int a = 0; a < 3; a++)
+    {
+        float nearLower, nearUpper, farLower, farUpper;
+        float nearBound = bounds[sign[a]][a], farBound = bounds[1 - sign[a]][a];
+        multiply(nearBound - originMax[a], nearBound - originMin[a], invMin[a], invMax[a], nearLower, nearUpper);
+        multiply(farBound - originMax[a], farBound - originMin[a], invMin[a], invMax[a], farLower, farUpper);
+        lower = std::max(lower, nearLower);
+        upper = std::min(upper, farUpper);
+    }
+    if (lower > upper)
+        return 0;
+
+    // 逐条光线求交，每次处理4条
+    uint64_t result = 0;
+    for (int g = 0; g < size; g += 4)
+    {
+        int group = (int)((mask >> g) & 0xF);
+        if (group == 0)
+            continue;
+#if defined(__SSE__)
+        __m128 t0 = _mm_load_ps(tmin + g), t1 = _mm_loadu_ps(t + g);
+        for (int a = 0; a < 3; a++)
+        {
+            __m128 o = _mm_load_ps(origin[a] + g), inv = _mm_load_ps(invDirection[a] + g);
+            __m128 near = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bounds[sign[a]][a]), o), inv);
+            __m128 far = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bounds[1 - sign[a]][a]), o), inv);
+            t0 = _mm_max_ps(t0, near);
+            t1 = _mm_min_ps(t1, far);
+        }
+        group &= _mm_movemask_ps(_mm_cmple_ps(t0, t1));
+#else
+        for (int k = 0; k < 4; k++)
+        {
+            int i = g + k;
+            float t0 = tmin[i], t1 = t[i];
+            for (int a = 0; a < 3; a++)
+            {
+                t0 = std::max(t0, (bounds[sign[a]][a] - origin[a][i]) * invDirection[a][i]);
+                t1 = std::min(t1, (bounds[1 - sign[a]][a] - origin[a][i]) * invDirection[a][i]);
+            }
+            if (!(t0 <= t1))
+                group &= ~(1 << k);
+        }
+#endif
+        result |= (uint64_t)group << g;
+    }
+    return result;
+}
+
+float RayPacket::order(const AABB &aabb) const
+{
+    return QVector3D::dotProduct(aabb.getCenter(), meanDirection);
+}
+
+HitPacket::HitPacket(const RayPacket &packet)
+{
+    for (int i = 0; i < RayPacket::MAX_SIZE; i++)
+    {
+        t[i] = i < packet.getSize() ? packet.getTMax(i) : 0.0f;
+        u[i] = v[i] = 0.0f;
+        mesh[i] = primitive[i] = -1;
+    }
+}
+
+HitRecord HitPacket::getRecord(int i) const
+{
+    HitRecord hit;
+    if (mesh[i] >= 0)
+    {
+        hit.t = t[i];
+        hit.mesh = mesh[i];
+        hit.primitive = primitive[i];
+        hit.u = u[i];
+        hit.v = v[i];
+    }
+    return hit;
+}
@@ -0,0 +1,311 @@
+#include "Sampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// 两个32位整数的哈希（lowbias32）
+static inline uint32_t hash(uint32_t a, uint32_t b)
+{
+    uint32_t x = a ^ (b * 0x9e3779b9u + 0x7f4a7c15u);
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// 32位整数的高24位映射到[0,1)
+static inline float toUnit(uint32_t v)
+{
+    return (float)(v >> 8) * (1.0f / 16777216.0f);
+}
+
+static inline uint32_t reverseBits(uint32_t x)
+{
+    x = (x << 16) | (x >> 16);
+    x = ((x & 0x00ff00ffu) << 8) | ((x & 0xff00ff00u) >> 8);
+    x = ((x & 0x0f0f0f0fu) << 4) | ((x & 0xf0f0f0f0u) >> 4);
+    x = ((x & 0x33333333u) << 2) | ((x & 0xccccccccu) >> 2);
+    x = ((x & 0x55555555u) << 1) | ((x & 0xaaaaaaaau) >> 1);
+    return x;
+}
+
+// Laine-Karras置换：每一位只受更低位影响，作用在位反转的整数上即为Owen置乱
+static inline uint32_t laineKarras(uint32_t x, uint32_t seed)
+{
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return x;
+}
+
+static inline uint32_t owenScramble(uint32_t x, uint32_t seed)
+{
+    return reverseBits(laineKarras(reverseBits(x), seed));
+}
+
+// Sobol序列第二维：生成矩阵的各列为v_k = v_{k-1} ^ (v_{k-1} >> 1)，
+// 矩阵乘法在GF(2)上是线性的，按字节查表后异或即可，不必逐位循环
+struct SobolTable
+{
+    uint32_t bytes[4][256];
+    SobolTable()
+    {
+        uint32_t columns[32];
+        columns[0] = 1u << 31;
+        for (int k = 1; k < 32; k++)
+            columns[k] = columns[k - 1] ^ (columns[k - 1] >> 1);
+        for (int b = 0; b < 4; b++)
+            for (int value = 0; value < 256; value++)
+            {
+                uint32_t result = 0;
+                for (int k = 0; k < 8; k++)
+                    if (value & (1 << k))
+                        result ^= columns[b * 8 + k];
+                bytes[b][value] = result;
+            }
+    }
+};
+static const SobolTable sobolTable;
+
+static inline uint32_t sobolSecond(uint32_t index)
+{
+    return sobolTable.bytes[0][index & 0xff] ^ sobolTable.bytes[1][(index >> 8) & 0xff] ^
+           sobolTable.bytes[2][(index >> 16) & 0xff] ^ sobolTable.bytes[3][index >> 24];
+}
+
+// 第pair对维度的Owen置乱Sobol点，两维共用同一个置乱后的样本序号，seed决定置乱
+static inline void sobolPair(uint32_t index, uint32_t pair, uint32_t seed, float &first, float &second)
+{
+    uint32_t pairSeed = hash(seed, pair);
+    uint32_t shuffled = owenScramble(index, pairSeed);
+    first = toUnit(owenScramble(reverseBits(shuffled), hash(pairSeed, 1)));
+    second = toUnit(owenScramble(sobolSecond(shuffled), hash(pairSeed, 2)));
+}
+
+/**********************************************************************************************/
+Sampler::Sampler() : x(0), y(0), index(0), dimension(0), pixelSeed(0) {}
+
+Sampler::~Sampler() {}
+
+void Sampler::restart() {}
+
+void Sampler::start(uint32_t x, uint32_t y, uint32_t sample, uint32_t dimension)
+{
+    this->x = x;
+    this->y = y;
+    index = sample;
+    this->dimension = dimension;
+    pixelSeed = hash(hash(x, y), (uint32_t)RANDOM_SEED);
+    restart();
+}
+
+void Sampler::setDimension(uint32_t dimension)
+{
+    this->dimension = dimension;
+    restart();
+}
+
+void RandomSampler::restart()
+{
+    generator.seed(((uint64_t)pixelSeed << 32) | hash(pixelSeed, index), RANDOM_SEED);
+    if (dimension > 0)
+        generator.advance(dimension);
+}
+
+float RandomSampler::next()
+{
+    dimension++;
+    return generator.nextFloat();
+}
+
+SobolSampler::SobolSampler() : cachedPair(UINT32_MAX) {}
+
+void SobolSampler::restart()
+{
+    cachedPair = UINT32_MAX;
+}
+
+float SobolSampler::next()
+{
+    uint32_t d = dimension++;
+    if (d >> 1 != cachedPair)
+    {
+        cachedPair = d >> 1;
+        sobolPair(index, cachedPair, pixelSeed, cached[0], cached[1]);
+    }
+    return cached[d & 1];
+}
+
+static const int HALTON_DIMENSIONS = 64;
+static const uint32_t HALTON_PRIMES[HALTON_DIMENSIONS] = {
+    2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53,
+    59, 61, 67, 71, 73, 79, 83, 89, 97, 101, 103, 107, 109, 113, 127, 131,
+    137, 139, 149, 151, 157, 163, 167, 173, 179, 181, 191, 193, 197, 199, 211, 223,
+    227, 229, 233, 239, 241, 251, 257, 263, 269, 271, 277, 281, 283, 293, 307, 311};
+
+float HaltonSampler::next()
+{
+    uint32_t d = dimension++;
+    if (d >= HALTON_DIMENSIONS)
+        return toUnit(hash(hash(pixelSeed, d), index));
+    // 以base为底的根逆，每一位数字经过随机的仿射置换(a * digit + c) mod base（base为素数，a不为0时是双射），
+    // 否则样本数较少时大素数维度上的取值都挤在0附近；高于样本序号位数的0也会被置换，直到精度用完
+    uint32_t base = HALTON_PRIMES[d], n = index, seed = hash(pixelSeed, d);
+    double inverse = 1.0 / base, scale = inverse, value = 0.0;
+    for (uint32_t k = 0; scale > 1.0 / 16777216.0; k++, n /= base, scale *= inverse)
+    {
+        uint32_t h = hash(seed, k);
+        uint32_t a = 1 + h % (base - 1 > 0 ? base - 1 : 1), c = (h >> 16) % base;
+        value += ((a * (n % base) + c) % base) * scale;
+    }
+    float result = (float)value;
+    // 转为float时可能舍入到1
+    return result < 1.0f ? result : 0.99999994f;
+}
+
+/**********************************************************************************************/
+// 用void-and-cluster方法（Ulichney 1993）生成BLUE_NOISE_SIZE x BLUE_NOISE_SIZE的蓝噪声掩码，取值为[0,1)内的均匀排名
+static std::vector<float> buildBlueNoise()
+{
+    const int n = BLUE_NOISE_SIZE, count = n * n;
+    // 环面上的高斯核，按坐标差查表
+    std::vector<float> kernel(count);
+    for (int dy = 0; dy < n; dy++)
+        for (int dx = 0; dx < n; dx++)
+        {
+            float ddx = (float)std::min(dx, n - dx), ddy = (float)std::min(dy, n - dy);
+            kernel[dy * n + dx] = std::exp(-(ddx * ddx + ddy * ddy) / (2.0f * 1.5f * 1.5f));
+        }
+    std::vector<char> pattern(count, 0);
+    std::vector<float> energy(count, 0.0f);
+    auto toggle = [&](std::vector<char> &bits, std::vector<float> &field, int p, bool on) {
+        bits[p] = on;
+        int px = p % n, py = p / n;
+        float sign = on ? 1.0f : -1.0f;
+        for (int qy = 0; qy < n; qy++)
+            for (int qx = 0; qx < n; qx++)
+                field[qy * n + qx] += sign * kernel[((qy - py + n) % n) * n + (qx - px + n) % n];
+    };
+    // 1的最密集处（能量最大的1）与最大空隙（能量最小的0）
+    auto tightest = [&](const std::vector<char> &bits, const std::vector<float> &field) {
+        int best = -1;
+        for (int p = 0; p < count; p++)
+            if (bits[p] && (best < 0 || field[p] > field[best]))
+                best = p;
+        return best;
+    };
+    auto largestVoid = [&](const std::vector<char> &bits, const std::vector<float> &field) {
+        int best = -1;
+        for (int p = 0; p < count; p++)
+            if (!bits[p] && (best < 0 || field[p] < field[best]))
+                best = p;
+        return best;
+    };
+
+    // 初始图案：随机放置约10%的1，再反复把最密集的1移到最大空隙直到稳定
+    PCG32 generator;
+    generator.seed(RANDOM_SEED, 0);
+    int ones = count / 10;
+    for (int placed = 0; placed < ones;)
+    {
+        int p = (int)(generator.next() % count);
+        if (!pattern[p])
+        {
+            toggle(pattern, energy, p, true);
+            placed++;
+        }
+    }
+    for (int iteration = 0; iteration < count; iteration++)
+    {
+        int cluster = tightest(pattern, energy);
+        toggle(pattern, energy, cluster, false);
+        int hole = largestVoid(pattern, energy);
+        toggle(pattern, energy, hole, true);
+        if (hole == cluster)
+            break;
+    }
+
+    std::vector<int> rank(count, 0);
+    // 初始图案中的1按从密到疏的顺序取得排名ones-1..0
+    std::vector<char> bits = pattern;
+    std::vector<float> field = energy;
+    for (int r = ones - 1; r >= 0; r--)
+    {
+        int cluster = tightest(bits, field);
+        rank[cluster] = r;
+        toggle(bits, field, cluster, false);
+    }
+    // 其余位置依次填入最大空隙，取得排名ones..count-1（高斯核之和为常数，0的最密集处即1的最大空隙）
+    for (int r = ones; r < count; r++)
+    {
+        int hole = largestVoid(pattern, energy);
+        rank[hole] = r;
+        toggle(pattern, energy, hole, true);
+    }
+
+    std::vector<float> mask(count);
+    for (int p = 0; p < count; p++)
+        mask[p] = ((float)rank[p] + 0.5f) / (float)count;
+    return mask;
+}
+
+BlueNoiseSampler::BlueNoiseSampler() : cachedPair(UINT32_MAX) {}
+
+void BlueNoiseSampler::restart()
+{
+    cachedPair = UINT32_MAX;
+}
+
+float BlueNoiseSampler::next()
+{
+    static const std::vector<float> mask = buildBlueNoise();
+    uint32_t d = dimension++;
+    // 所有像素共用同一序列，旋转量来自蓝噪声掩码，每一维的掩码按哈希值平移以去除维度间的相关
+    if (d >> 1 != cachedPair)
+    {
+        cachedPair = d >> 1;
+        sobolPair(index, cachedPair, (uint32_t)RANDOM_SEED, cached[0], cached[1]);
+    }
+    float value = cached[d & 1];
+    uint32_t offset = hash(d, (uint32_t)RANDOM_SEED);
+    uint32_t mx = (x + offset) % BLUE_NOISE_SIZE, my = (y + (offset >> 16)) % BLUE_NOISE_SIZE;
+    value += mask[my * BLUE_NOISE_SIZE + mx];
+    return value >= 1.0f ? value - 1.0f : value;
+}
+
+/**********************************************************************************************/
+std::unique_ptr<Sampler> createSampler(SamplerType type)
+{
+    switch (type)
+    {
+    case SAMPLER_SOBOL:
+        return std::unique_ptr<Sampler>(new SobolSampler());
+    case SAMPLER_HALTON:
+        return std::unique_ptr<Sampler>(new HaltonSampler());
+    case SAMPLER_BLUE_NOISE:
+        return std::unique_ptr<Sampler>(new BlueNoiseSampler());
+    default:
+        return std::unique_ptr<Sampler>(new RandomSampler());
+    }
+}
+
+Sampler &threadSampler()
+{
+    static thread_local std::unique_ptr<Sampler> sampler = createSampler(SAMPLER_TYPE);
+    return *sampler;
+}
+
+void startSample(uint32_t x, uint32_t y, uint32_t sample, uint32_t dimension)
+{
+    threadSampler().start(x, y, sample, dimension);
+}
+
+void setSampleDimension(uint32_t dimension)
+{
+    threadSampler().setDimension(dimension);
+}
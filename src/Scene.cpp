@@ -10,11 +10,25 @@ Scene::Scene(const std::string &meshPath, bool threshold_method)
     double start = cpuSecond();
 
     this->threshold_method=threshold_method;
+    std::string directory = meshPath.substr(0, meshPath.find_last_of('/'));
+    std::string xmlpath = meshPath.substr(0, meshPath.find_last_of('.')) + ".xml";
+
+    // 场景文件内容未变时直接从缓存映射网格与BVH，跳过模型解析、纹理解码与BVH构建
+    std::string cachepath = meshPath.substr(0, meshPath.find_last_of('.')) + ".cache";
+    uint64_t hash = 0;
+    if (SCENE_CACHE_ENABLED)
+    {
+        hash = hashSceneFiles(meshPath, xmlpath);
+        if (loadCache(cachepath, hash))
+        {
+            spdlog::info("从缓存读取模型完毕，共花费: {:.6f}s", cpuSecond() - start);
+            return;
+        }
+    }
+
     // 利用Assimp读取场景obj文件，返回aiScene
     Assimp::Importer importer; // 后处理：强制为三角形、翻转纹理
     const aiScene *scene = importer.ReadFile(meshPath, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenSmoothNormals);
-    std::string directory = meshPath.substr(0, meshPath.find_last_of('/'));
-    std::string xmlpath = meshPath.substr(0, meshPath.find_last_of('.')) + ".xml";
 
     tinyxml2::XMLDocument doc;
     doc.LoadFile(xmlpath.c_str());
@@ -29,41 +43,42 @@ Scene::Scene(const std::string &meshPath, bool threshold_method)
         lightnode = lightnode->NextSiblingElement("light");
     }
 
-    if (scene)
-        processNode(scene->mRootNode, scene, directory, lightmap);
-    else
+    if (!scene)
     {
         spdlog::critical("模型读取失败！");
         return;
     }
+    // 先建立材料表，网格只记录材质下标
+    for (int i = 0; i < (int)scene->mNumMaterials; i++)
+        materials.push_back(processMaterial(scene->mMaterials[i], lightmap));
+    processNode(scene->mRootNode, scene, directory);
+    buildTopLevel();
+    buildEmitters();
 
     double end = cpuSecond();
     spdlog::info("模型读取完毕，共花费: {:.6f}s", end - start);
+
+    if (SCENE_CACHE_ENABLED)
+        saveCache(cachepath, hash);
 }
 
 Scene::~Scene() {}
 
 // aiScene是一个node-hierarchy，进行递归处理
-void Scene::processNode(const aiNode *node, const aiScene *scene, const std::string &directory, std::map<std::string, QVector3D> lightmap)
+void Scene::processNode(const aiNode *node, const aiScene *scene, const std::string &directory)
 {
     // 处理当前节点的mesh，节点存储的是索引，真正的mesh存储在aiMesh中
     for (int i = 0; i < node->mNumMeshes; i++)
     {
         aiMesh *aimesh = scene->mMeshes[node->mMeshes[i]];
-        Mesh mesh = processMesh(aimesh, scene, directory, lightmap);
-        meshes.push_back(mesh);
-        if (!mesh.getMaterial().getEmissive().isNull())
-        {
-            light_meshes.emplace_back(mesh);
-            lightarea += mesh.getArea();
-        }
+        meshes.push_back(processMesh(aimesh, scene, directory));
     }
     // 递归处理子节点
     for (int i = 0; i < node->mNumChildren; i++)
-        processNode(node->mChildren[i], scene, directory, lightmap);
+        processNode(node->mChildren[i], scene, directory);
 }
 
-Mesh Scene::processMesh(const aiMesh *mesh, const aiScene *scene, const std::string &directory, std::map<std::string, QVector3D> lightmap) const
+Mesh Scene::processMesh(const aiMesh *mesh, const aiScene *scene, const std::string &directory) const
 {
 
     // 处理顶点
@@ -88,34 +103,36 @@ Mesh Scene::processMesh(const aiMesh *mesh, const aiScene *scene, const std::str
         triangles.emplace_back(p0, p1, p2);
     }
 
-    // 处理材质 一个mesh对应一个material
-    aiMaterial *materialTemp = scene->mMaterials[mesh->mMaterialIndex];
+    // 一个mesh对应一个material，材料本身已在材料表中
+    Texture texture = processTexture(scene->mMaterials[mesh->mMaterialIndex], directory);
+
+    return Mesh(triangles, mesh->mMaterialIndex, texture);
+}
+
+Material Scene::processMaterial(const aiMaterial *material, const std::map<std::string, QVector3D> &lightmap) const
+{
     aiColor3D diffuseTemp, specularTemp, transmittanceTemp;
     float shininess, ior;
-    materialTemp->Get(AI_MATKEY_COLOR_DIFFUSE, diffuseTemp);
-    materialTemp->Get(AI_MATKEY_COLOR_SPECULAR, specularTemp);
+    material->Get(AI_MATKEY_COLOR_DIFFUSE, diffuseTemp);
+    material->Get(AI_MATKEY_COLOR_SPECULAR, specularTemp);
 
     // 从xml文件中查询是否有对应材料名字的light
     aiString materialName;
-    materialTemp->Get(AI_MATKEY_NAME, materialName);
+    material->Get(AI_MATKEY_NAME, materialName);
     std::string lightname = materialName.C_Str();
     QVector3D emissive;
-    if (lightmap.count(lightname))
+    auto light = lightmap.find(lightname);
+    if (light != lightmap.end())
     {
-        emissive = lightmap[lightname];
+        emissive = light->second;
     }
-    materialTemp->Get(AI_MATKEY_COLOR_TRANSPARENT, transmittanceTemp);
-    materialTemp->Get(AI_MATKEY_SHININESS, shininess);
-    materialTemp->Get(AI_MATKEY_REFRACTI, ior);
+    material->Get(AI_MATKEY_COLOR_TRANSPARENT, transmittanceTemp);
+    material->Get(AI_MATKEY_SHININESS, shininess);
+    material->Get(AI_MATKEY_REFRACTI, ior);
     QVector3D diffuse(diffuseTemp.r, diffuseTemp.g, diffuseTemp.b);
     QVector3D specular(specularTemp.r, specularTemp.g, specularTemp.b);
     QVector3D transmittance(transmittanceTemp.r, transmittanceTemp.g, transmittanceTemp.b);
-    Material material(diffuse, specular, emissive, shininess, transmittance, ior, threshold_method);
-
-    // 处理diffuse纹理
-    Texture texture = processTexture(materialTemp, directory);
-
-    return Mesh(triangles, material, texture);
+    return Material(diffuse, specular, emissive, shininess, transmittance, ior, threshold_method);
 }
 
 Texture Scene::processTexture(const aiMaterial *material, const std::string &directory) const
@@ -131,147 +148,704 @@ Texture Scene::processTexture(const aiMaterial *material, const std::string &dir
         return Texture(QImage());
 }
 
-// 根据ray遍历每个mesh进行光线追踪，返回截交点t、位置、材料和纹理等相关信息
-void Scene::trace(const Ray &ray, float &t, Point &point, Material &material, QVector3D &color) const
+// 每个发光三角形的功率取辐射度三个分量的平均值乘以面积
+void Scene::buildEmitters()
+{
+    emitters.clear();
+    emitterOffsets.assign(meshes.size(), -1);
+    std::vector<float> powers;
+    for (int i = 0; i < (int)meshes.size(); i++)
+    {
+        const Mesh &mesh = meshes[i];
+        QVector3D radiance = materials[mesh.getMaterialId()].getEmissive();
+        if (radiance.isNull())
+            continue;
+        emitterOffsets[i] = (int)emitters.size();
+        for (const Triangle &triangle : mesh.getTriangles())
+        {
+            Emitter emitter;
+            emitter.v0 = triangle.getVertex(0).getPosition();
+            emitter.e1 = triangle.getVertex(1).getPosition() - emitter.v0;
+            emitter.e2 = triangle.getVertex(2).getPosition() - emitter.v0;
+            QVector3D cross = QVector3D::crossProduct(emitter.e1, emitter.e2);
+            // 面积为0的三角形也保留以使下标与图元一一对应，其功率为0，不会被采样到
+            emitter.area = 0.5f * cross.length();
+            // 顶点顺序不一定与法线朝向一致，以顶点法线之和为准
+            QVector3D shading = triangle.getVertex(0).getNormal() + triangle.getVertex(1).getNormal() + triangle.getVertex(2).getNormal();
+            emitter.normal = cross.normalized();
+            if (QVector3D::dotProduct(emitter.normal, shading) < 0.0f)
+                emitter.normal = -emitter.normal;
+            emitter.radiance = radiance;
+            emitters.push_back(emitter);
+            powers.push_back((radiance.x() + radiance.y() + radiance.z()) / 3.0f * emitter.area);
+        }
+    }
+    emitterTable = AliasTable(powers);
+}
+
+// 两层结构：顶层BVH以网格的aabb为图元，每个网格自身的BVH作为底层结构
+void Scene::buildTopLevel()
+{
+    std::vector<AABB> bounds;
+    std::vector<QVector3D> centers;
+    for (const Mesh &mesh : meshes)
+    {
+        bounds.push_back(mesh.getAABB());
+        centers.push_back(mesh.getAABB().getCenter());
+    }
+    std::vector<BVHNode> nodes;
+    std::vector<int> indices;
+    BVHBuilder(bounds, centers).build(nodes, indices);
+    topNodes = CacheArray<BVHNode>(std::move(nodes));
+    topIndices = CacheArray<int>(std::move(indices));
+}
+
+// 缓存文件头，任何一项与当前程序不一致时缓存失效
+struct SceneCacheHeader
+{
+    char magic[8];
+    int32_t version, nodeSize, triangleSize, recordSize, buildMethod, width, maxLeafSize, sahBins, mortonBits, lbvhLeafSize, treeletPasses, sbvhBins;
+    float sbvhAlpha, sbvhBudget;
+    uint64_t hash;
+};
+
+static SceneCacheHeader makeCacheHeader(uint64_t hash)
+{
+    SceneCacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "PTSCENE", 8);
+    header.version = SCENE_CACHE_VERSION;
+    header.nodeSize = sizeof(BVHNode);
+    header.triangleSize = sizeof(Triangle);
+    header.recordSize = sizeof(TriangleRecord);
+    header.buildMethod = BVH_BUILD_METHOD;
+    header.width = BVH_WIDTH;
+    header.maxLeafSize = BVH_MAX_LEAF_SIZE;
+    header.sahBins = BVH_SAH_BINS;
+    header.mortonBits = BVH_LBVH_MORTON_BITS;
+    header.lbvhLeafSize = BVH_LBVH_LEAF_SIZE;
+    header.treeletPasses = BVH_LBVH_TREELET_PASSES;
+    header.sbvhBins = BVH_SBVH_BINS;
+    header.sbvhAlpha = BVH_SBVH_ALPHA;
+    header.sbvhBudget = BVH_SBVH_BUDGET;
+    header.hash = hash;
+    return header;
+}
+
+// 缓存布局：文件头、材料表、网格数量、每个网格（三角形、BVH、材料下标、纹理）、顶层BVH
+// 三角形、节点、索引与求交数据都按内存布局写入，加载时直接引用映射内存，只检查下标是否越界
+bool Scene::loadCache(const std::string &cachePath, uint64_t hash)
+{
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>(cachePath);
+    if (!file->isOpen())
+        return false;
+    CacheReader reader(file->getData(), file->getSize());
+    SceneCacheHeader header = reader.read<SceneCacheHeader>(), expected = makeCacheHeader(hash);
+    if (reader.fail() || std::memcmp(&header, &expected, sizeof(header)) != 0)
+    {
+        spdlog::info("场景缓存已过期: {}", cachePath);
+        return false;
+    }
+    std::vector<Material> cachedMaterials;
+    uint64_t materialCount = reader.read<uint64_t>();
+    for (uint64_t i = 0; i < materialCount && !reader.fail(); i++)
+        cachedMaterials.emplace_back(reader, threshold_method);
+    std::vector<Mesh> cached;
+    uint64_t count = reader.read<uint64_t>();
+    bool valid = true;
+    for (uint64_t i = 0; i < count && !reader.fail(); i++)
+    {
+        cached.emplace_back(reader);
+        // 材料下标越界说明缓存已损坏
+        valid = valid && cached.back().getMaterialId() >= 0 && cached.back().getMaterialId() < (int)cachedMaterials.size();
+    }
+    CacheArray<BVHNode> nodes = reader.viewArray<BVHNode>();
+    CacheArray<int> indices = reader.viewArray<int>();
+    valid = valid && isValidTree(nodes.data(), nodes.size(), indices.size());
+    for (size_t i = 0; i < indices.size() && valid; i++)
+        valid = indices[i] >= 0 && (size_t)indices[i] < cached.size();
+    if (reader.fail() || !valid)
+    {
+        spdlog::warn("场景缓存已损坏: {}", cachePath);
+        return false;
+    }
+    materials.swap(cachedMaterials);
+    meshes.swap(cached);
+    topNodes = std::move(nodes);
+    topIndices = std::move(indices);
+    buildEmitters();
+    cacheFile = file;
+    return true;
+}
+
+void Scene::saveCache(const std::string &cachePath, uint64_t hash) const
 {
-    t = FLT_MAX;
+    double start = cpuSecond();
+    CacheWriter writer(cachePath);
+    writer.write(makeCacheHeader(hash));
+    writer.write<uint64_t>(materials.size());
+    for (const Material &material : materials)
+        material.save(writer);
+    writer.write<uint64_t>(meshes.size());
     for (const Mesh &mesh : meshes)
+        mesh.save(writer);
+    writer.writeArray(topNodes);
+    writer.writeArray(topIndices);
+    if (writer.commit())
+        spdlog::info("场景缓存写入完毕，共花费: {:.6f}s", cpuSecond() - start);
+    else
+        spdlog::warn("场景缓存写入失败: {}", cachePath);
+}
+
+// 根据ray遍历顶层BVH，只对光线可能到达的网格进行光线追踪，只记录最近交点的t、网格与三角形下标以及重心坐标
+// 找到交点后缩小光线的tmax，使后续网格的底层BVH也能剔除更远的节点
+bool Scene::intersect(const Ray &ray, HitRecord &hit) const
+{
+    if (topNodes.empty())
+        return false;
+    Ray rayTemp = ray;
+    rayTemp.setTMax(std::min(ray.getTMax(), hit.t));
+    traverseClosest(topNodes.data(), 0, rayTemp, [&](int offset, int count) {
+        for (int i = offset; i < offset + count; i++)
+            if (meshes[topIndices[i]].trace(rayTemp, hit))
+            {
+                hit.mesh = topIndices[i];
+                rayTemp.setTMax(hit.t);
+            }
+    });
+    return hit.mesh >= 0;
+}
+
+// 光线包遍历顶层BVH，叶节点中的网格用光线包遍历各自的BVH
+void Scene::intersect(const RayPacket &packet, HitRecord *hits) const
+{
+    if (!packet.isCoherent())
+    {
+        for (int i = 0; i < packet.getSize(); i++)
+            intersect(packet.getRay(i), hits[i]);
+        return;
+    }
+    HitPacket hit(packet);
+    if (!topNodes.empty())
+        traversePacket(topNodes.data(), packet, packet.getMask(), hit.t, [&](int index, uint64_t active) {
+            const BVHNode &node = topNodes[index];
+            for (int i = node.offset; i < node.offset + node.count; i++)
+            {
+                uint64_t updated = meshes[topIndices[i]].tracePacket(packet, active, hit);
+                for (int k = 0; k < packet.getSize(); k++)
+                    if ((updated >> k) & 1)
+                        hit.mesh[k] = topIndices[i];
+            }
+            return node.count > 0;
+        });
+    for (int i = 0; i < packet.getSize(); i++)
+        hits[i] = hit.getRecord(i);
+}
+
+// 将每个轴STREAM_CELL_BITS位的单元坐标交错为Morton码
+static uint32_t interleaveCell(uint32_t x, uint32_t y, uint32_t z)
+{
+    uint32_t code = 0;
+    for (int b = 0; b < STREAM_CELL_BITS; b++)
+        code |= (((x >> b) & 1) << (3 * b + 2)) | (((y >> b) & 1) << (3 * b + 1)) | (((z >> b) & 1) << (3 * b));
+    return code;
+}
+
+// 方向各分量的符号组成的卦限编号
+static inline uint32_t octantOf(const Ray &ray)
+{
+    QVector3D d = ray.getDirection();
+    return (d.x() < 0.0f ? 4 : 0) | (d.y() < 0.0f ? 2 : 0) | (d.z() < 0.0f ? 1 : 0);
+}
+
+// 排序键的最高3位为方向卦限，其余为起点在场景包围盒中的单元Morton码，
+// 键不超过16位，用两趟8位的LSD基数排序得到求交顺序
+void Scene::sortStream(const std::vector<Ray> &rays, std::vector<int> &order) const
+{
+    const int cells = 1 << STREAM_CELL_BITS;
+    QVector3D low = topNodes[0].aabb.getMin(), extent = topNodes[0].aabb.getMax() - low;
+    QVector3D scale;
+    for (int a = 0; a < 3; a++)
+        scale[a] = extent[a] > 0.0f ? cells / extent[a] : 0.0f;
+
+    int n = (int)rays.size();
+    std::vector<uint16_t> keys(n);
+    for (int i = 0; i < n; i++)
+    {
+        QVector3D o = rays[i].getOrigin();
+        uint32_t q[3];
+        for (int a = 0; a < 3; a++)
+            q[a] = (uint32_t)std::min(std::max((o[a] - low[a]) * scale[a], 0.0f), (float)(cells - 1));
+        keys[i] = (uint16_t)((octantOf(rays[i]) << (3 * STREAM_CELL_BITS)) | interleaveCell(q[0], q[1], q[2]));
+    }
+    std::vector<int> temp(n);
+    order.resize(n);
+    for (int i = 0; i < n; i++)
+        temp[i] = i;
+    for (int shift = 0; shift < 16; shift += 8)
+    {
+        int counts[257] = {0};
+        for (int i = 0; i < n; i++)
+            counts[((keys[i] >> shift) & 0xff) + 1]++;
+        for (int k = 1; k < 257; k++)
+            counts[k] += counts[k - 1];
+        for (int i = 0; i < n; i++)
+        {
+            int index = temp[i];
+            order[counts[(keys[index] >> shift) & 0xff]++] = index;
+        }
+        if (shift == 0)
+            temp.swap(order);
+    }
+}
+
+// 排序后的光线流按卦限相同的连续光线分组，方向足够集中的组作为一个光线包求交，其余逐条求交，结果按原顺序写回
+// 未排序的小批光线相干性差，组成光线包反而更慢，直接逐条求交
+void Scene::traceStream(const std::vector<Ray> &rays, std::vector<HitRecord> &hits) const
+{
+    int n = (int)rays.size();
+    hits.assign(n, HitRecord());
+    if (n == 0 || topNodes.empty())
+        return;
+    std::vector<int> order;
+    int packetSize = 1;
+    if (n >= STREAM_SORT_THRESHOLD)
+    {
+        sortStream(rays, order);
+        packetSize = std::min(STREAM_PACKET_SIZE, RayPacket::MAX_SIZE);
+    }
+    else
+    {
+        order.resize(n);
+        for (int i = 0; i < n; i++)
+            order[i] = i;
+    }
+
+    // 先划分好各组的起点，再并行求交
+    std::vector<int> groups;
+    for (int i = 0; i < n; i++)
+    {
+        int size = i - (groups.empty() ? 0 : groups.back());
+        if (groups.empty() || size >= packetSize || octantOf(rays[order[i]]) != octantOf(rays[order[i - 1]]))
+            groups.push_back(i);
+    }
+    groups.push_back(n);
+
+#pragma omp parallel for schedule(dynamic, 16) if (n >= STREAM_SORT_THRESHOLD)
+    for (int g = 0; g < (int)groups.size() - 1; g++)
     {
-        float tTemp;
-        Point pointTemp;
-        mesh.trace(ray, tTemp, pointTemp);
-        if (tTemp < t)
+        int begin = groups[g], end = groups[g + 1];
+        if (end - begin > 1)
         {
-            t = tTemp;
-            point = pointTemp;
-            material = mesh.getMaterial();
-            color = mesh.color(point.getUV());
+            std::vector<Ray> packetRays;
+            for (int i = begin; i < end; i++)
+                packetRays.push_back(rays[order[i]]);
+            RayPacket packet(packetRays);
+            if (packet.getSpread() >= STREAM_PACKET_MIN_SPREAD)
+            {
+                HitRecord packetHits[RayPacket::MAX_SIZE];
+                intersect(packet, packetHits);
+                for (int i = begin; i < end; i++)
+                    hits[order[i]] = packetHits[i - begin];
+                continue;
+            }
         }
+        for (int i = begin; i < end; i++)
+            intersect(rays[order[i]], hits[order[i]]);
     }
 }
 
-// 在读取材料的自发射系数后，根据材料是玻璃材料还是Phong材料进行不同的积分渲染处理
-QVector3D Scene::shade(const Ray &ray, const Point &point, const Material &material, const QVector3D &color, const int bounce) const
+// 只对最终最近的交点插值法线与纹理坐标并读取纹理
+void Scene::resolve(const Ray &ray, const HitRecord &hit, Point &point, QVector3D &color) const
+{
+    const Mesh &mesh = meshes[hit.mesh];
+    point = mesh.interpolate(ray, hit);
+    color = mesh.color(point.getUV());
+}
+
+const Material &Scene::getMaterial(const HitRecord &hit) const
+{
+    return materials[meshes[hit.mesh].getMaterialId()];
+}
+
+// 按任意顺序遍历顶层BVH，任意网格在光线区间内有交点即为遮挡
+bool Scene::occluded(const QVector3D &origin, const QVector3D &target) const
+{
+    QVector3D direction = target - origin;
+    float distance = direction.length();
+    // 终点略微提前，避免与目标所在的表面相交
+    Ray ray(origin, direction / distance, EPSILON, distance * (1.0f - SHADOW_EPSILON));
+    if (topNodes.empty())
+        return false;
+    return traverseAny(topNodes.data(), ray, [&](int offset, int count) -> bool {
+        for (int i = offset; i < offset + count; i++)
+            if (meshes[topIndices[i]].occluded(ray))
+                return true;
+        return false;
+    });
+}
+
+// 策略pdf相对另一策略other的MIS权重，写成比值形式以避免pdf很大时平方溢出
+static inline float misWeight(float pdf, float other)
+{
+    if (MIS_HEURISTIC == MIS_NONE)
+        return 1.0f;
+    if (pdf <= 0.0f)
+        return 0.0f;
+    float ratio = other / pdf;
+    if (MIS_HEURISTIC == MIS_POWER)
+        ratio *= ratio;
+    return 1.0f / (1.0f + ratio);
+}
+
+// 对光源采样（区域光）计算Phong材料着色点的直接光照
+// 每次采样先按功率从所有发光三角形中选择一个，再在三角形上均匀采样，
+// 此时pdf为 (power(A)/总功率)*1/area(A)，单次采样的代价与光源数量无关
+QVector3D Scene::directLighting(const Point &point, const QVector3D &reflection, const Material &material, const QVector3D &color) const
 {
     QVector3D position = point.getPosition();
     QVector3D normal = point.getNormal();
-    QVector3D reflection = ray.reflect(normal);
-
     QVector3D sum(0.0f, 0.0f, 0.0f);
-    // 自发射光          +    积分处理
-    // 根据表面渲染方程，output_color = self-emission_color + integeral_with_Li*brdf*cos_in_all_direction
+    if (emitterTable.empty())
+        return sum;
+    for (int k = 0; k < LIGHT_SAMPLES; k++)
+    {
+        // 每次光源采样固定取RANDOM_LIGHT_DIMENSIONS维：三角形内的位置、选择三角形、选择brdf波瓣，被跳过的样本也占用这些维度
+        float u = std::sqrt(randomUniform()), v = randomUniform();
+        float pick = randomUniform(), coin = randomUniform(), lobe = randomUniform();
+        // 选择发光三角形并根据重心坐标随机采样
+        int index = emitterTable.sample(pick, coin);
+        const Emitter &emitter = emitters[index];
+        QVector3D target = emitter.v0 + u * (1.0f - v) * emitter.e1 + u * v * emitter.e2;
+        QVector3D offset = target - position;
+        float squaredDistance = offset.lengthSquared();
+        QVector3D direction = offset / std::sqrt(squaredDistance);
+
+        float cosine0 = QVector3D::dotProduct(normal, direction);
+        float cosine1 = QVector3D::dotProduct(emitter.normal, -direction);
+        // 贡献为0时不需要发出阴影光线
+        if (cosine0 <= 0.0f || cosine1 <= 0.0f)
+            continue;
+        // 能直接看到光源，没有被遮挡
+        if (occluded(position, target))
+            continue;
+        QVector3D brdf;
+        // 计算着色点的brdf
+        if (lobe <= material.getThreshold())
+            brdf = material.diffuseBRDF() * color;
+        else
+            brdf = material.specularBRDF(reflection, direction);
+        // 转换到立体角测度的光源采样pdf：pdf_area * squared_distance / cosine1
+        float lightPdf = emitterTable.pdf(index) / emitter.area * squaredDistance / cosine1;
+        // 入射光 * brdf * cosine0 / pdf_light * MIS权重
+        float weight = misWeight(LIGHT_SAMPLES * lightPdf, material.pdf(normal, reflection, direction));
+        sum += emitter.radiance * brdf * cosine0 * weight / lightPdf;
+    }
+    return sum / LIGHT_SAMPLES;
+}
 
-    // 1.自发射光
-    QVector3D ans = material.getEmissive();
+QVector3D Scene::emission(const Ray &ray, const HitRecord &hit, float brdfPdf) const
+{
+    int index = emitterOffsets[hit.mesh] + hit.primitive;
+    const Emitter &emitter = emitters[index];
+    // 所有发光三角形的功率都为0时别名表为空，面积为0的三角形不会被光源采样选中
+    if (emitterTable.empty() || emitter.area <= 0.0f)
+        return QVector3D(0.0f, 0.0f, 0.0f);
+    float length = ray.getDirection().length();
+    QVector3D direction = ray.getDirection() / length;
+    // 与光源采样一致，只计入光源正面的自发射光
+    float cosine = QVector3D::dotProduct(emitter.normal, -direction);
+    if (cosine <= 0.0f)
+        return QVector3D(0.0f, 0.0f, 0.0f);
+    float distance = hit.t * length;
+    float lightPdf = emitterTable.pdf(index) / emitter.area * distance * distance / cosine;
+    return emitter.radiance * misWeight(brdfPdf, LIGHT_SAMPLES * lightPdf);
+}
 
-    // 积分处理
-    /************************************************************************/
+static inline float maxComponent(const QVector3D &v)
+{
+    return std::max(std::max(v.x(), v.y()), v.z());
+}
 
-    // 2.玻璃材料
-    //   进行折射计算判断（模拟理想的折射btdf）
-    if (material.getIor() > 1 && (bounce < RUSSIAN_ROULETTE_THRESHOLD || randomUniform() < RUSSIAN_ROULETTE_PROBABILITY))
+// 迭代式路径追踪：沿路径累积通量throughput（各顶点brdf*cos/pdf与轮盘赌概率倒数之积），
+// 每个顶点的贡献为 通量 * (自发射光 + 直接光照)
+// 根据表面渲染方程，output_color = self-emission_color + integeral_with_Li*brdf*cos_in_all_direction
+QVector3D Scene::integrate(const Ray &cameraRay, const HitRecord &cameraHit) const
+{
+    QVector3D radiance(0.0f, 0.0f, 0.0f), throughput(1.0f, 1.0f, 1.0f);
+    Ray ray = cameraRay;
+    HitRecord hit = cameraHit;
+    for (int depth = 0;; depth++)
     {
+        const Material &material = getMaterial(hit);
+        Point point;
+        QVector3D color;
+        resolve(ray, hit, point, color);
+        QVector3D normal = point.getNormal();
+        QVector3D reflection = ray.reflect(normal);
+        // 玻璃材料模拟理想的折射btdf，不计算直接光照
+        bool glass = material.getIor() > 1;
+
+        // 本次弹射的采样维度从dimension开始，依次为光源采样、出射方向、选择波瓣与俄罗斯轮盘
+        uint32_t dimension = RANDOM_PATH_DIMENSION + depth * RANDOM_BOUNCE_DIMENSIONS;
+        uint32_t scatterDimension = dimension + RANDOM_LIGHT_DIMENSIONS * LIGHT_SAMPLES;
+
+        // 1.自发射光
+        radiance += throughput * material.getEmissive();
+        // 2.Phong材料的直接光照
+        if (!glass)
+        {
+            setSampleDimension(dimension);
+            radiance += throughput * directLighting(point, reflection, material, color);
+        }
+
+        // 3.采样出射方向，玻璃材料按折射/反射采样，Phong材料根据brdf进行重要性采样
+        if (depth >= PATH_MAX_DEPTH)
+            break;
         QVector3D direction, albedo;
-        // 玻璃材料的采样
-        material.refract(normal, ray, direction, albedo);
-
-        Ray rayTemp(position, direction);
-        float tTemp;
-        Point pointTemp;
-        Material materialTemp;
-        QVector3D colorTemp;
-        trace(rayTemp, tTemp, pointTemp, materialTemp, colorTemp);
-        if (tTemp < FLT_MAX)
+        if (glass)
         {
-            ans += shade(rayTemp, pointTemp, materialTemp, colorTemp, bounce + 1) * albedo / (bounce < RUSSIAN_ROULETTE_THRESHOLD ? 1.0f : RUSSIAN_ROULETTE_PROBABILITY);
+            // 玻璃只需要选择反射或折射的一维，使用选择波瓣的维度
+            setSampleDimension(scatterDimension + 2);
+            material.refract(normal, ray, direction, albedo);
         }
-        return ans;
-    }
+        else
+        {
+            setSampleDimension(scatterDimension);
+            material.sample(normal, reflection, color, direction, albedo);
+        }
+        throughput *= albedo;
+        if (throughput.isNull())
+            break;
 
-    // Phong材料
-    //  3.遍历光源，对光源进行采样（区域光），
-    //    可以从光源中随机选择一个光源，然后再从光源中进行采样，此时pdf为 (area(A)/总的光源的面积)*1/area(A)
-    //    也可以遍历所有的光源，实验中选取这种方案，效果更好能加快收敛, 此时pdf为 1/area(A)
+        // 4.俄罗斯轮盘赌：以通量的最大分量作为继续的概率，贡献小的路径更早终止
+        if (depth >= RUSSIAN_ROULETTE_THRESHOLD)
+        {
+            float probability = std::min(maxComponent(throughput), RUSSIAN_ROULETTE_MAX_PROBABILITY);
+            setSampleDimension(scatterDimension + 3);
+            if (randomUniform() >= probability)
+                break;
+            throughput /= probability;
+        }
 
-    for (Mesh mesh : light_meshes)
-    {
+        ray = Ray(point.getPosition(), direction);
+        hit = HitRecord();
+        if (!intersect(ray, hit))
+            break;
+        // Phong材料的间接光线击中光源时终止，自发射光按MIS权重计入，其余部分已由光源采样计入
+        if (!glass && !getMaterial(hit).getEmissive().isNull())
+        {
+            if (MIS_HEURISTIC != MIS_NONE)
+                radiance += throughput * emission(ray, hit, material.pdf(normal, reflection, direction));
+            break;
+        }
+    }
+    return radiance;
+}
 
-        // 对此光源进行采样
-        Point sample = mesh.sample(point);
-        QVector3D direction = (sample.getPosition() - position).normalized();
-        Ray rayTemp(position, direction);
-        float tTemp;
-        Point pointTemp;
-        Material materialTemp;
-        QVector3D colorTemp;
-        trace(rayTemp, tTemp, pointTemp, materialTemp, colorTemp);
+void Scene::sampleTile(const Camera &cam, const std::vector<std::pair<int, int>> &pixels, const uint32_t *indices, QVector3D *radiance, FirstHit *first) const
+{
+    // i,j为图像坐标，每个样本的随机数只由像素与样本序号决定
+    int count = (int)pixels.size();
+    std::vector<Ray> rays;
+    for (int n = 0; n < count; n++)
+    {
+        startSample(pixels[n].first, pixels[n].second, indices[n], 0);
+        rays.push_back(cam.cast_ray(pixels[n].first, pixels[n].second));
+    }
+    // 光追判断
+    HitRecord hits[RayPacket::MAX_SIZE];
+    if (count > 1)
+        intersect(RayPacket(rays), hits);
+    else
+        intersect(rays[0], hits[0]);
 
-        // 能直接看到光源，没有被遮挡
-        if ((pointTemp.getPosition() - sample.getPosition()).lengthSquared() < EPSILON)
+    for (int n = 0; n < count; n++)
+    {
+        const HitRecord &hit = hits[n];
+        if (first)
         {
-            float cosine0 = std::max(QVector3D::dotProduct(normal, direction), 0.0f);
-            float cosine1 = std::max(QVector3D::dotProduct(sample.getNormal(), -direction), 0.0f);
-            QVector3D brdf;
-            // 计算着色点的brdf
-            if (randomUniform() <= material.getThreshold())
-                brdf = material.diffuseBRDF() * color;
+            if (hit.mesh < 0)
+                first[n] = FirstHit{QVector3D(0, 0, 0), QVector3D(0, 0, 0), 0.0f};
             else
-                brdf = material.specularBRDF(reflection, direction);
-            // 入射光 * brdf * cosine0 * cosine1 / pdf_light / squared_distance
-            sum += mesh.getMaterial().getEmissive() * brdf * cosine0 * cosine1 * mesh.getArea() / (sample.getPosition() - position).lengthSquared();
+            {
+                Point point;
+                QVector3D color;
+                resolve(rays[n], hit, point, color);
+                // 法线统一朝向相机，光源的反照率取1，使其辐射度在解调后保持不变
+                QVector3D normal = point.getNormal();
+                if (QVector3D::dotProduct(normal, rays[n].getDirection()) > 0.0f)
+                    normal = -normal;
+                const Material &material = getMaterial(hit);
+                QVector3D albedo = material.getEmissive().isNull() ? material.albedo(color) : QVector3D(1, 1, 1);
+                first[n] = FirstHit{albedo, normal, hit.t * rays[n].getDirection().length()};
+            }
+        }
+        // 没有与场景中的物体截交
+        if (hit.mesh < 0)
+            radiance[n] = QVector3D(0, 0, 0);
+        // 与区域光源截交
+        else if (!getMaterial(hit).getEmissive().isNull())
+            radiance[n] = getMaterial(hit).getEmissive();
+        // 与物体截交
+        else
+        {
+            startSample(pixels[n].first, pixels[n].second, indices[n], RANDOM_PATH_DIMENSION);
+            radiance[n] = integrate(rays[n], hit);
         }
     }
-    ans += sum;
-    
-    // 4.计算Phong材料的间接照明
-    if (bounce < RUSSIAN_ROULETTE_THRESHOLD || randomUniform() < RUSSIAN_ROULETTE_PROBABILITY)
-    {
-        QVector3D direction, albedo;
-        // 根据brdf采样
-        material.sample(normal, reflection, color, direction, albedo);
+}
 
-        Ray rayTemp(position, direction);
-        float tTemp;
-        Point pointTemp;
-        Material materialTemp;
-        QVector3D colorTemp;
-        trace(rayTemp, tTemp, pointTemp, materialTemp, colorTemp);
+void Scene::render(const Camera &cam, Framebuffer &frame, int samples, const std::function<void(const Tile &)> &onTileDone, AOVBuffers *aovs) const
+{
+    int threads = omp_get_max_threads();
+    TileScheduler scheduler(frame.getWidth(), frame.getHeight(), RENDER_TILE_SIZE, threads);
+    // 线程私有的累积缓冲区只在线程数或图像大小变化时重新分配，每轮结束时都已清零
+    if (FRAMEBUFFER_PER_THREAD && ((int)threadFrames.size() != threads || threadFrames[0].getWidth() != frame.getWidth() || threadFrames[0].getHeight() != frame.getHeight()))
+        threadFrames.assign(threads, Framebuffer(frame.getWidth(), frame.getHeight()));
 
-        if (tTemp < FLT_MAX && materialTemp.getEmissive().isNull())
+#pragma omp parallel
+    {
+        int thread = omp_get_thread_num();
+        Framebuffer &target = FRAMEBUFFER_PER_THREAD ? threadFrames[thread] : frame;
+        // 本线程渲染过的块，结束时只合并这些区域
+        std::vector<Tile> rendered;
+        Tile tile;
+        while (scheduler.next(thread, tile))
         {
-            //         Shade(p,-wi) * brdf * cosine  / pdf / p_rr
-            ans += shade(rayTemp, pointTemp, materialTemp, colorTemp, bounce + 1) * albedo / (bounce < RUSSIAN_ROULETTE_THRESHOLD ? 1.0f : RUSSIAN_ROULETTE_PROBABILITY);
+            // 渲染块内再以PACKET_TILE_SIZE的小块生成主光线，同一小块的主光线作为光线包一起求交
+            int step = std::max(PACKET_TILE_SIZE, 1);
+            for (int y0 = tile.y0; y0 < tile.y1; y0 += step)
+                for (int x0 = tile.x0; x0 < tile.x1; x0 += step)
+                {
+                    std::vector<std::pair<int, int>> pixels;
+                    for (int j = y0; j < std::min(y0 + step, tile.y1); j++)
+                        for (int i = x0; i < std::min(x0 + step, tile.x1); i++)
+                            pixels.emplace_back(i, j);
+                    int count = (int)pixels.size();
+                    QVector3D radiance[RayPacket::MAX_SIZE], total[RayPacket::MAX_SIZE];
+                    FirstHit first[RayPacket::MAX_SIZE];
+                    QVector3D albedo[RayPacket::MAX_SIZE], normal[RayPacket::MAX_SIZE], depth[RayPacket::MAX_SIZE];
+                    // 样本序号从像素已有的样本数开始，渲染过程中frame的样本数不会变化
+                    uint32_t indices[RayPacket::MAX_SIZE];
+                    for (int n = 0; n < count; n++)
+                        indices[n] = (uint32_t)frame.getWeight(pixels[n].first, pixels[n].second);
+                    for (int s = 0; s < samples; s++)
+                    {
+                        sampleTile(cam, pixels, indices, radiance, aovs ? first : nullptr);
+                        for (int n = 0; n < count; n++)
+                            indices[n]++;
+                        for (int n = 0; n < count; n++)
+                            total[n] += radiance[n];
+                        if (aovs)
+                            for (int n = 0; n < count; n++)
+                            {
+                                albedo[n] += first[n].albedo;
+                                normal[n] += first[n].normal;
+                                depth[n] += QVector3D(first[n].depth, first[n].depth, first[n].depth);
+                            }
+                    }
+                    for (int n = 0; n < count; n++)
+                        target.add(pixels[n].first, pixels[n].second, total[n], (float)samples);
+                    // 不同块的像素互不重叠，辅助缓冲区直接写入，不需要线程私有的副本
+                    if (aovs)
+                        for (int n = 0; n < count; n++)
+                        {
+                            aovs->albedo.add(pixels[n].first, pixels[n].second, albedo[n], (float)samples);
+                            aovs->normal.add(pixels[n].first, pixels[n].second, normal[n], (float)samples);
+                            aovs->depth.add(pixels[n].first, pixels[n].second, depth[n], (float)samples);
+                        }
+                }
+            rendered.push_back(tile);
+            if (onTileDone)
+                onTileDone(tile);
         }
+        // 各线程的块互不重叠，可以同时合并到frame中
+        if (FRAMEBUFFER_PER_THREAD)
+            for (const Tile &done : rendered)
+                frame.mergeRegion(target, done.x0, done.y0, done.x1, done.y1);
     }
-    return ans;
 }
 
-void Scene::sample(const Camera &cam, std::vector<std::vector<QVector3D>> &sum)
+void Scene::sample(const Camera &cam, Framebuffer &frame)
+{
+    render(cam, frame, 1);
+}
+
+// 像素本轮的样本数：不足ADAPTIVE_MIN_SAMPLES时先补足，此后与相对误差超出阈值的倍数成正比
+static int adaptiveSamples(const PixelStatistics &pixel, int maxSamples)
 {
+    int count = pixel.getCount();
+    if (count >= maxSamples || pixel.isConverged())
+        return 0;
+    int samples = ADAPTIVE_MIN_SAMPLES - count;
+    if (samples <= 0)
+        samples = (int)std::ceil(std::min((float)ADAPTIVE_PASS_SAMPLES, pixel.relativeError() / ADAPTIVE_ERROR_THRESHOLD));
+    return std::max(1, std::min(std::min(samples, ADAPTIVE_PASS_SAMPLES), maxSamples - count));
+}
 
-    double start = cpuSecond();
+int Scene::sampleAdaptive(const Camera &cam, PixelStatisticsBuffer &pixels, Framebuffer &frame, int maxSamples, AOVBuffers *aovs)
+{
+    TileScheduler scheduler(frame.getWidth(), frame.getHeight(), RENDER_TILE_SIZE, omp_get_max_threads());
+    int active = 0;
 
-#pragma omp parallel for schedule(dynamic)
-    // i,j为图像坐标
-    for (int i = 0; i < sum.size(); i++)
-        for (int j = 0; j < sum[i].size(); j++)
+#pragma omp parallel reduction(+ : active)
+    {
+        int thread = omp_get_thread_num();
+        Tile tile;
+        std::vector<std::pair<int, int>> block, open;
+        std::vector<int> budget;
+        while (scheduler.next(thread, tile))
         {
-            // 形成射线
-            Ray ray = cam.cast_ray(i, j);
-            float t;
-            Point point;
-            Material material;
-            QVector3D color;
-            // 光追判断
-            trace(ray, t, point, material, color);
-            // 没有与场景中的物体截交
-            if (t == FLT_MAX)
-                sum[i][j] += QVector3D(0, 0, 0);
-            // 与区域光源截交
-            else if (!material.getEmissive().isNull())
-                sum[i][j] += material.getEmissive();
-            // 与物体截交
-            else
-                sum[i][j] += shade(ray, point, material, color, 0);
+            int step = std::max(PACKET_TILE_SIZE, 1);
+            for (int y0 = tile.y0; y0 < tile.y1; y0 += step)
+                for (int x0 = tile.x0; x0 < tile.x1; x0 += step)
+                {
+                    // 小块中尚未收敛的像素及其本轮的样本数，全部收敛的小块直接跳过
+                    block.clear();
+                    budget.clear();
+                    for (int j = y0; j < std::min(y0 + step, tile.y1); j++)
+                        for (int i = x0; i < std::min(x0 + step, tile.x1); i++)
+                        {
+                            int samples = adaptiveSamples(pixels.at(i, j), maxSamples);
+                            if (samples > 0)
+                            {
+                                block.emplace_back(i, j);
+                                budget.push_back(samples);
+                            }
+                        }
+                    int blockSize = (int)block.size();
+                    // 第round次只为样本数大于round的像素生成主光线，误差大的像素在后几次中单独组成光线包
+                    for (int round = 0;; round++)
+                    {
+                        open.clear();
+                        for (int n = 0; n < blockSize; n++)
+                            if (budget[n] > round)
+                                open.push_back(block[n]);
+                        int openSize = (int)open.size();
+                        if (openSize == 0)
+                            break;
+                        QVector3D radiance[RayPacket::MAX_SIZE];
+                        FirstHit first[RayPacket::MAX_SIZE];
+                        uint32_t indices[RayPacket::MAX_SIZE];
+                        for (int n = 0; n < openSize; n++)
+                            indices[n] = (uint32_t)pixels.at(open[n].first, open[n].second).getCount();
+                        sampleTile(cam, open, indices, radiance, aovs ? first : nullptr);
+                        for (int n = 0; n < openSize; n++)
+                        {
+                            pixels.at(open[n].first, open[n].second).add(radiance[n]);
+                            frame.add(open[n].first, open[n].second, radiance[n]);
+                            if (aovs)
+                            {
+                                aovs->albedo.add(open[n].first, open[n].second, first[n].albedo);
+                                aovs->normal.add(open[n].first, open[n].second, first[n].normal);
+                                aovs->depth.add(open[n].first, open[n].second, QVector3D(first[n].depth, first[n].depth, first[n].depth));
+                            }
+                        }
+                        active += openSize;
+                    }
+                }
         }
-}
\ No newline at end of file
+    }
+    return active;
+}
@@ -0,0 +1,197 @@
+#include "SceneCache.h"
+
+#include <cstdio>
+#include <algorithm>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+MappedFile::MappedFile(const std::string &path) : data(nullptr), length(0)
+{
+#ifdef _WIN32
+    std::ifstream stream(path, std::ios::binary | std::ios::ate);
+    if (!stream)
+        return;
+    buffer.resize((size_t)stream.tellg());
+    stream.seekg(0);
+    stream.read(buffer.data(), buffer.size());
+    if (stream)
+    {
+        data = buffer.data();
+        length = buffer.size();
+    }
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+    struct stat info;
+    if (fstat(fd, &info) == 0)
+    {
+        length = (size_t)info.st_size;
+        // 长度为0的文件无法映射，用空字符串代替
+        if (length == 0)
+            data = "";
+        else
+        {
+            void *address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address != MAP_FAILED)
+                data = (const char *)address;
+            else
+                length = 0;
+        }
+    }
+    close(fd);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifndef _WIN32
+    if (data != nullptr && length > 0)
+        munmap((void *)data, length);
+#endif
+}
+
+bool MappedFile::isOpen() const
+{
+    return data != nullptr;
+}
+
+const char *MappedFile::getData() const
+{
+    return data;
+}
+
+size_t MappedFile::getSize() const
+{
+    return length;
+}
+
+CacheWriter::CacheWriter(const std::string &path) : path(path), tempPath(path + ".tmp"), stream(tempPath, std::ios::binary | std::ios::trunc), position(0) {}
+
+CacheWriter::~CacheWriter()
+{
+    // 未提交的临时文件直接删除
+    if (stream.is_open())
+    {
+        stream.close();
+        std::remove(tempPath.c_str());
+    }
+}
+
+bool CacheWriter::fail() const
+{
+    return !stream;
+}
+
+void CacheWriter::pad()
+{
+    static const char zeros[16] = {0};
+    size_t padding = (16 - position % 16) % 16;
+    stream.write(zeros, padding);
+    position += padding;
+}
+
+bool CacheWriter::commit()
+{
+    stream.close();
+    if (!stream)
+    {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+#ifdef _WIN32
+    std::remove(path.c_str());
+#endif
+    // 已映射旧缓存的进程仍持有旧文件，重命名不会影响它们
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+    {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+CacheReader::CacheReader(const char *data, size_t size) : data(data), size(size), position(0), failed(data == nullptr) {}
+
+bool CacheReader::fail() const
+{
+    return failed;
+}
+
+void CacheReader::invalidate()
+{
+    failed = true;
+}
+
+bool CacheReader::require(size_t bytes)
+{
+    if (failed || position > size || bytes > size - position)
+        failed = true;
+    return !failed;
+}
+
+// 按8字节一组进行FNV风格的混合，比逐字节的FNV-1a快得多，大型obj文件的哈希开销接近读文件本身
+static uint64_t hashBytes(uint64_t hash, const char *data, size_t size)
+{
+    const uint64_t prime = 0x100000001b3ULL;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * prime;
+        hash ^= hash >> 29;
+    }
+    for (; i < size; i++)
+        hash = (hash ^ (unsigned char)data[i]) * prime;
+    return hash;
+}
+
+// 将文件长度与内容混入哈希，文件不存在时混入一个特殊标记
+static uint64_t hashFile(uint64_t hash, const MappedFile &file)
+{
+    uint64_t size = file.isOpen() ? (uint64_t)file.getSize() : ~0ULL;
+    hash = hashBytes(hash, (const char *)&size, sizeof(size));
+    return file.isOpen() ? hashBytes(hash, file.getData(), file.getSize()) : hash;
+}
+
+// 找出obj文件中所有以mtllib开头的行所引用的材质文件
+static std::vector<std::string> findMaterialLibraries(const MappedFile &obj)
+{
+    std::vector<std::string> names;
+    if (!obj.isOpen())
+        return names;
+    const char *begin = obj.getData(), *end = begin + obj.getSize();
+    const std::string keyword = "mtllib";
+    for (const char *p = begin; (p = std::search(p, end, keyword.begin(), keyword.end())) != end; p += keyword.size())
+    {
+        if (p != begin && p[-1] != '\n')
+            continue;
+        const char *lineEnd = std::find(p + keyword.size(), end, '\n');
+        std::string name(p + keyword.size(), lineEnd);
+        size_t first = name.find_first_not_of(" \t\r");
+        size_t last = name.find_last_not_of(" \t\r");
+        if (first != std::string::npos)
+            names.push_back(name.substr(first, last - first + 1));
+    }
+    return names;
+}
+
+uint64_t hashSceneFiles(const std::string &meshPath, const std::string &xmlPath)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    // mtllib相对obj所在目录；路径中没有分隔符时即为当前目录
+    size_t slash = meshPath.find_last_of("/\\");
+    std::string directory = slash == std::string::npos ? std::string(".") : meshPath.substr(0, slash);
+    MappedFile obj(meshPath);
+    hash = hashFile(hash, obj);
+    for (const std::string &name : findMaterialLibraries(obj))
+        hash = hashFile(hash, MappedFile(directory + "/" + name));
+    hash = hashFile(hash, MappedFile(xmlPath));
+    return hash;
+}
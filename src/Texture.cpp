@@ -2,6 +2,15 @@
 
 Texture::Texture(const QImage &image) : image(image) {}
 
+Texture::Texture(CacheReader &reader)
+{
+    int width = reader.read<int32_t>(), height = reader.read<int32_t>();
+    size_t count;
+    const uchar *pixels = reader.view<uchar>(count);
+    if (pixels != nullptr && width > 0 && height > 0 && count == (size_t)width * height * 4)
+        image = QImage(pixels, width, height, width * 4, QImage::Format_RGB32);
+}
+
 Texture::~Texture() {}
 
 bool Texture::isNull() const
@@ -9,6 +18,15 @@ bool Texture::isNull() const
     return image.isNull();
 }
 
+// 统一转换为每像素4字节的RGB32格式，此时每行没有额外的填充字节
+void Texture::save(CacheWriter &writer) const
+{
+    QImage pixels = image.isNull() ? QImage() : image.convertToFormat(QImage::Format_RGB32);
+    writer.write<int32_t>(pixels.width());
+    writer.write<int32_t>(pixels.height());
+    writer.writeArray(pixels.constBits(), pixels.isNull() ? 0 : (size_t)pixels.width() * pixels.height() * 4);
+}
+
 // 双线性插值求取纹理坐标
 QVector3D Texture::color(const QVector2D &uv) const
 {
@@ -0,0 +1,67 @@
+#include "TileScheduler.h"
+
+#include <algorithm>
+#include <cstdint>
+
+// 将16位的块坐标交错为32位的Morton码
+static uint32_t interleaveTile(uint32_t x, uint32_t y)
+{
+    uint32_t code = 0;
+    for (int b = 0; b < 16; b++)
+        code |= ((x >> b) & 1u) << (2 * b) | ((y >> b) & 1u) << (2 * b + 1);
+    return code;
+}
+
+TileScheduler::TileScheduler(int width, int height, int size, int threads)
+{
+    size = std::max(size, 1);
+    threads = std::max(threads, 1);
+    int tilesX = (width + size - 1) / size, tilesY = (height + size - 1) / size;
+    std::vector<std::pair<uint32_t, Tile>> order;
+    for (int ty = 0; ty < tilesY; ty++)
+        for (int tx = 0; tx < tilesX; tx++)
+        {
+            Tile tile = {tx * size, ty * size, std::min((tx + 1) * size, width), std::min((ty + 1) * size, height)};
+            order.emplace_back(interleaveTile(tx, ty), tile);
+        }
+    std::sort(order.begin(), order.end(), [](const std::pair<uint32_t, Tile> &a, const std::pair<uint32_t, Tile> &b) { return a.first < b.first; });
+
+    for (int t = 0; t < threads; t++)
+    {
+        queues.emplace_back(new Queue());
+        size_t begin = order.size() * t / threads, end = order.size() * (t + 1) / threads;
+        for (size_t i = begin; i < end; i++)
+            queues[t]->tiles.push_back(order[i].second);
+    }
+}
+
+TileScheduler::~TileScheduler() {}
+
+bool TileScheduler::next(int thread, Tile &tile)
+{
+    int count = (int)queues.size();
+    thread %= count;
+    {
+        Queue &own = *queues[thread];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tiles.empty())
+        {
+            tile = own.tiles.front();
+            own.tiles.pop_front();
+            return true;
+        }
+    }
+    // 自己的队列已空，依次尝试从其它线程队列的尾部窃取，尾部的块离该线程正在渲染的区域最远
+    for (int k = 1; k < count; k++)
+    {
+        Queue &victim = *queues[(thread + k) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tiles.empty())
+        {
+            tile = victim.tiles.back();
+            victim.tiles.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
@@ -5,13 +5,16 @@ Triangle::Triangle(const Point &p0, const Point &p1, const Point &p2) : p0(p0),
                                                                         p2(p2),
                                                                         center((p0.getPosition() + p1.getPosition() + p2.getPosition()) / 3.0f) {}
 
-Triangle::~Triangle() {}
-
 QVector3D Triangle::getCenter() const
 {
     return center;
 }
 
+Point Triangle::getVertex(int index) const
+{
+    return index == 0 ? p0 : (index == 1 ? p1 : p2);
+}
+
 float Triangle::area() const
 {
     // Sabc=1/2*|ab|*|ac|*sinθ
@@ -27,6 +30,13 @@ AABB Triangle::aabb() const
     return ans;
 }
 
+Point Triangle::interpolate(const QVector3D &position, float u, float v) const
+{
+    QVector3D normal = ((1.0f - u - v) * p0.getNormal() + u * p1.getNormal() + v * p2.getNormal()).normalized();
+    QVector2D uv = (1.0f - u - v) * p0.getUV() + u * p1.getUV() + v * p2.getUV();
+    return Point(position, normal, uv);
+}
+
 // 利用MT三角形相交算法来进行
 void Triangle::trace(const Ray &ray, float &t, Point &point) const
 {
@@ -47,13 +57,11 @@ void Triangle::trace(const Ray &ray, float &t, Point &point) const
         float tTemp = QVector3D::dotProduct(e2, s1) / w;
         float u = QVector3D::dotProduct(s, s2) / w;
         float v = QVector3D::dotProduct(d, s1) / w;
-        if (tTemp > EPSILON && u >= 0.0f && v >= 0.0f && u + v <= 1.0f)
+        // 交点需要位于光线的有效区间内
+        if (tTemp > ray.getTMin() && tTemp < ray.getTMax() && u >= 0.0f && v >= 0.0f && u + v <= 1.0f)
         {
             t = tTemp;
-            QVector3D position = ray.point(t);
-            QVector3D normal = ((1.0f - u - v) * p0.getNormal() + u * p1.getNormal() + v * p2.getNormal()).normalized();
-            QVector2D uv = (1.0f - u - v) * p0.getUV() + u * p1.getUV() + v * p2.getUV();
-            point = Point(position, normal, uv);
+            point = interpolate(ray.point(t), u, v);
         }
         else
             t = FLT_MAX;
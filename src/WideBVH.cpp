@@ -0,0 +1,202 @@
+#include "WideBVH.h"
+
+#if defined(__SSE__) || defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+WideRay::WideRay(const Ray &ray)
+{
+    QVector3D o = ray.getOrigin(), d = ray.getDirection();
+    for (int a = 0; a < 3; a++)
+    {
+        origin[a] = o[a];
+        invDirection[a] = std::fabs(d[a]) > EPSILON ? 1.0f / d[a] : (d[a] < 0.0f ? -1.0f : 1.0f) / EPSILON;
+        sign[a] = d[a] < 0.0f ? 1 : 0;
+    }
+    tmin = ray.getTMin();
+}
+
+template <int N>
+WideBVH<N>::WideBVH() {}
+
+template <int N>
+WideBVH<N>::WideBVH(const std::vector<BVHNode> &binary)
+{
+    // 空网格的根节点是没有三角形的叶节点，此时不构建多叉BVH
+    if (binary.size() > 1 || (binary.size() == 1 && binary[0].count > 0))
+    {
+        std::vector<WideBVHNode<N>> built;
+        collapse(binary, 0, built);
+        nodes = CacheArray<WideBVHNode<N>>(std::move(built));
+    }
+}
+
+template <int N>
+WideBVH<N>::WideBVH(CacheReader &reader) : nodes(reader.viewArray<WideBVHNode<N>>()) {}
+
+template <int N>
+WideBVH<N>::~WideBVH() {}
+
+template <int N>
+void WideBVH<N>::save(CacheWriter &writer) const
+{
+    writer.writeArray(nodes);
+}
+
+template <int N>
+bool WideBVH<N>::empty() const
+{
+    return nodes.empty();
+}
+
+template <int N>
+bool WideBVH<N>::isValid(size_t primitives) const
+{
+    for (size_t i = 0; i < nodes.size(); i++)
+        for (int k = 0; k < N; k++)
+        {
+            int32_t child = nodes[i].child[k], count = nodes[i].count[k];
+            if (count == 0 && (child <= (int64_t)i || child >= (int64_t)nodes.size()))
+                return false;
+            if (count > 0 && (child < 0 || (size_t)child + count > primitives))
+                return false;
+            if (count < -1)
+                return false;
+        }
+    return true;
+}
+
+template <int N>
+const WideBVHNode<N> &WideBVH<N>::getNode(int index) const
+{
+    return nodes[index];
+}
+
+template <int N>
+int WideBVH<N>::collapse(const std::vector<BVHNode> &binary, int index, std::vector<WideBVHNode<N>> &built)
+{
+    int wide = (int)built.size();
+    built.push_back(WideBVHNode<N>());
+
+    // 从二叉节点的两个子节点出发，反复展开表面积最大的内部子节点
+    std::vector<int> children;
+    if (binary[index].count > 0)
+        children.push_back(index);
+    else
+    {
+        children.push_back(index + 1);
+        children.push_back(binary[index].offset);
+    }
+    while (children.size() < N)
+    {
+        int best = -1;
+        float bestArea = -1.0f;
+        for (int i = 0; i < (int)children.size(); i++)
+        {
+            const BVHNode &node = binary[children[i]];
+            if (node.count == 0 && node.aabb.surfaceArea() > bestArea)
+            {
+                best = i;
+                bestArea = node.aabb.surfaceArea();
+            }
+        }
+        if (best < 0)
+            break;
+        int node = children[best];
+        children[best] = node + 1;
+        children.push_back(binary[node].offset);
+    }
+
+    WideBVHNode<N> result;
+    for (int i = 0; i < N; i++)
+    {
+        if (i < (int)children.size())
+        {
+            const BVHNode &node = binary[children[i]];
+            QVector3D low = node.aabb.getMin(), high = node.aabb.getMax();
+            for (int a = 0; a < 3; a++)
+            {
+                result.bounds[a][i] = low[a];
+                result.bounds[a + 3][i] = high[a];
+            }
+            result.count[i] = node.count;
+            result.child[i] = node.count > 0 ? node.offset : collapse(binary, children[i], built);
+        }
+        else
+        {
+            // 空槽位：最小值为正无穷、最大值为负无穷，任何光线都不会与之相交
+            for (int a = 0; a < 3; a++)
+            {
+                result.bounds[a][i] = FLT_MAX;
+                result.bounds[a + 3][i] = -FLT_MAX;
+            }
+            result.count[i] = -1;
+            result.child[i] = -1;
+        }
+    }
+    built[wide] = result;
+    return wide;
+}
+
+// 标量版本的slab测试，没有对应SIMD指令集时使用
+template <int N>
+int WideBVH<N>::intersect(const WideBVHNode<N> &node, const WideRay &ray, float tmax, float *tEntry)
+{
+    int mask = 0;
+    for (int i = 0; i < N; i++)
+    {
+        float t0 = ray.tmin, t1 = tmax;
+        for (int a = 0; a < 3; a++)
+        {
+            float near = (node.bounds[a + 3 * ray.sign[a]][i] - ray.origin[a]) * ray.invDirection[a];
+            float far = (node.bounds[a + 3 * (1 - ray.sign[a])][i] - ray.origin[a]) * ray.invDirection[a];
+            t0 = std::max(t0, near);
+            t1 = std::min(t1, far);
+        }
+        tEntry[i] = t0;
+        if (t0 <= t1)
+            mask |= 1 << i;
+    }
+    return mask;
+}
+
+#if defined(__SSE__)
+// SSE：一次与4个子节点求交
+template <>
+int WideBVH<4>::intersect(const WideBVHNode<4> &node, const WideRay &ray, float tmax, float *tEntry)
+{
+    __m128 t0 = _mm_set1_ps(ray.tmin), t1 = _mm_set1_ps(tmax);
+    for (int a = 0; a < 3; a++)
+    {
+        __m128 o = _mm_set1_ps(ray.origin[a]), inv = _mm_set1_ps(ray.invDirection[a]);
+        __m128 near = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.bounds[a + 3 * ray.sign[a]]), o), inv);
+        __m128 far = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.bounds[a + 3 * (1 - ray.sign[a])]), o), inv);
+        t0 = _mm_max_ps(t0, near);
+        t1 = _mm_min_ps(t1, far);
+    }
+    _mm_storeu_ps(tEntry, t0);
+    return _mm_movemask_ps(_mm_cmple_ps(t0, t1));
+}
+#endif
+
+#if defined(__AVX__)
+// AVX：一次与8个子节点求交
+template <>
+int WideBVH<8>::intersect(const WideBVHNode<8> &node, const WideRay &ray, float tmax, float *tEntry)
+{
+    __m256 t0 = _mm256_set1_ps(ray.tmin), t1 = _mm256_set1_ps(tmax);
+    for (int a = 0; a < 3; a++)
+    {
+        __m256 o = _mm256_set1_ps(ray.origin[a]), inv = _mm256_set1_ps(ray.invDirection[a]);
+        __m256 near = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(node.bounds[a + 3 * ray.sign[a]]), o), inv);
+        __m256 far = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(node.bounds[a + 3 * (1 - ray.sign[a])]), o), inv);
+        t0 = _mm256_max_ps(t0, near);
+        t1 = _mm256_min_ps(t1, far);
+    }
+    _mm256_storeu_ps(tEntry, t0);
+    return _mm256_movemask_ps(_mm256_cmp_ps(t0, t1, _CMP_LE_OQ));
+}
+#endif
+
+template class WideBVH<4>;
+template class WideBVH<8>;
\ No newline at end of file
@@ -0,0 +1,174 @@
+// 命令行渲染器，不依赖Qt Widgets与图形界面的事件循环，用于无显示器的渲染节点上的批量渲染
+// 用法: pathtracer-cli <obj路径> [-s 样本数] [-t 线程数] [-b 时间预算(秒)] [-o 输出路径] [--adaptive] [--denoise] [--highlight]
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <omp.h>
+
+#include <QImage>
+#include <QString>
+
+#include <tinyxml2/tinyxml2.h>
+
+#include "ConfigHelper.h"
+#include "UtilsHelper.h"
+#include "Denoiser.h"
+#include "Scene.h"
+#include "camera.h"
+#include <spdlog/spdlog.h>
+
+static void usage(const char *program)
+{
+    std::printf("usage: %s <obj> [options]\n"
+                "  -s, --spp N          samples per pixel (default %d)\n"
+                "  -t, --threads N      number of render threads (default: all cores)\n"
+                "  -b, --budget SECONDS stop after the pass that exceeds the time budget (default: none)\n"
+                "  -o, --output PATH    output image, format chosen by extension (default: <obj>.png)\n"
+                "  --adaptive           adaptive sampling, spp is the per-pixel maximum;\n"
+                "                       also writes a sample-count map to <output base>_samples.png\n"
+                "  --denoise            denoise with albedo/normal/depth AOVs before saving\n"
+                "  --highlight          highlight-suppressing sampling threshold method\n",
+                program, SAMPLE_PER_PIXEL);
+}
+
+static bool exists(const std::string &path)
+{
+    return std::ifstream(path).good();
+}
+
+int main(int argc, char **argv)
+{
+    std::string objpath, output;
+    int spp = SAMPLE_PER_PIXEL, threads = 0;
+    double budget = 0.0;
+    bool adaptive = false, denoise = false, threshold_method = false;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if ((arg == "-s" || arg == "--spp") && hasValue)
+            spp = std::atoi(argv[++i]);
+        else if ((arg == "-t" || arg == "--threads") && hasValue)
+            threads = std::atoi(argv[++i]);
+        else if ((arg == "-b" || arg == "--budget") && hasValue)
+            budget = std::atof(argv[++i]);
+        else if ((arg == "-o" || arg == "--output") && hasValue)
+            output = argv[++i];
+        else if (arg == "--adaptive")
+            adaptive = true;
+        else if (arg == "--denoise")
+            denoise = true;
+        else if (arg == "--highlight")
+            threshold_method = true;
+        else if (arg == "-h" || arg == "--help")
+        {
+            usage(argv[0]);
+            return 0;
+        }
+        else if (objpath.empty() && arg[0] != '-')
+            objpath = arg;
+        else
+        {
+            std::fprintf(stderr, "unknown or incomplete option: %s\n", arg.c_str());
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (objpath.empty() || spp <= 0 || threads < 0 || budget < 0.0)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    std::string base = objpath.substr(0, objpath.find_last_of('.'));
+    if (output.empty())
+        output = base + ".png";
+    if (threads > 0)
+        omp_set_num_threads(threads);
+
+    // 场景与相机，相机参数在与obj同名的xml文件中
+    std::string xmlpath = base + ".xml";
+    tinyxml2::XMLDocument doc;
+    if (!exists(objpath) || doc.LoadFile(xmlpath.c_str()) != tinyxml2::XML_SUCCESS)
+    {
+        spdlog::critical("找不到场景文件{}或相机文件{}", objpath, xmlpath);
+        return 2;
+    }
+    Scene scene(objpath, threshold_method);
+    Camera cam(doc);
+    int width = cam.getWidth();
+    int height = cam.getHeight();
+
+    spdlog::info("开始采样生成图像，{}x{}，每像素{}个样本，{}个线程", width, height, spp, omp_get_max_threads());
+    double start = cpuSecond();
+    Framebuffer frame(width, height);
+    std::unique_ptr<AOVBuffers> aovs(denoise ? new AOVBuffers(width, height) : nullptr);
+    // 与界面相同，按轮渲染，每轮结束时检查时间预算
+    if (adaptive)
+    {
+        PixelStatisticsBuffer pixels(width, height);
+        long long total = 0;
+        while (true)
+        {
+            int active = scene.sampleAdaptive(cam, pixels, frame, spp, aovs.get());
+            total += active;
+            if (active == 0 || (budget > 0.0 && cpuSecond() - start >= budget))
+                break;
+        }
+        spdlog::info("自适应采样完毕，平均每像素{:.2f}个样本，共花费: {:.6f}s", (double)total / ((double)width * height), cpuSecond() - start);
+    }
+    else
+    {
+        int done = 0;
+        while (done < spp)
+        {
+            int samples = std::min(RENDER_TILE_SAMPLES, spp - done);
+            scene.render(cam, frame, samples, nullptr, aovs.get());
+            done += samples;
+            if (budget > 0.0 && cpuSecond() - start >= budget)
+                break;
+        }
+        spdlog::info("采样生成图像完毕，每像素{}个样本，共花费: {:.6f}s", done, cpuSecond() - start);
+    }
+
+    QImage image(width, height, QImage::Format_RGB32);
+    if (aovs)
+    {
+        double denoiseStart = cpuSecond();
+        Denoiser denoiser(width, height);
+        Framebuffer denoised(width, height);
+        denoiser.denoise(frame, *aovs, denoised);
+        denoised.toImage(image);
+        spdlog::info("降噪完毕，共花费: {:.6f}s", cpuSecond() - denoiseStart);
+    }
+    else
+        frame.toImage(image);
+    if (!image.save(QString::fromStdString(output)))
+    {
+        spdlog::critical("图像保存失败：{}", output);
+        return 2;
+    }
+    spdlog::info("图像已保存到{}", output);
+
+    // 自适应采样时在输出旁保存样本数图，frame的权重即每个像素的样本数
+    if (adaptive)
+    {
+        std::string samplesPath = output;
+        size_t dot = output.find_last_of('.'), slash = output.find_last_of("/\\");
+        if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+            samplesPath = output.substr(0, dot);
+        samplesPath += "_samples.png";
+        QImage sampleMap(width, height, QImage::Format_RGB32);
+        frame.weightsToImage(sampleMap);
+        if (!sampleMap.save(QString::fromStdString(samplesPath)))
+        {
+            spdlog::critical("样本数图保存失败：{}", samplesPath);
+            return 2;
+        }
+        spdlog::info("样本数图已保存到{}", samplesPath);
+    }
+    return 0;
+}